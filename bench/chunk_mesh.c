@@ -0,0 +1,112 @@
+// Meshing cost at one chunk size, without a window or GL context. The same
+// BENCH_AREA x BENCH_AREA block terrain is cut into chunks of the compiled
+// size and meshed on the CPU, naive and greedy. The program prints the time
+// for the whole area, the cost of remeshing one chunk (what a block edit
+// costs in the frame it lands), the quads emitted and the draw calls the
+// area would take without a ChunkBatch. Build it once per size:
+//
+//   INC="-Isrc -Isrc/main -Isrc/libs/glad/include -Isrc/libs/glad/include/glad -Isrc/libs/glad/include/KHR -Isrc/libs/stb_image"
+//   SRC="bench/chunk_mesh.c src/libs/glad/src/glad.c src/libs/stb_image/stb_image.c"
+//   for s in 8 16 32 64; do
+//     gcc -std=gnu11 -O2 -DCHUNK_SIZE=$s $INC $SRC -o chunk_mesh_$s -lglfw -lm -lpthread -ldl && ./chunk_mesh_$s
+//   done
+//
+// CHUNK_HEIGHT stays 64 unless given, so every size meshes the same columns.
+#include <time.h>
+#ifndef CHUNK_HEIGHT
+#define CHUNK_HEIGHT 64
+#endif
+#include "Chunk.h"
+
+#define BENCH_AREA 256
+#define BENCH_SIDE (BENCH_AREA / CHUNK_SIZE)
+#define BENCH_REMESHES 2000
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// snapshot and mesh every chunk that has faces; returns the seconds taken
+static double Bench_meshAll(struct Chunk* chunks, struct ChunkMeshSource* src, ChunkMeshMode mode, long* quads, int* drawCalls) {
+    *quads = 0;
+    *drawCalls = 0;
+    double t0 = now();
+    for (int i = 0; i < BENCH_SIDE * BENCH_SIDE; i++) {
+        if (Chunk_skipsMeshing(&chunks[i]))
+            continue;
+        struct ChunkMeshData data;
+        Chunk_snapshot(&chunks[i], src);
+        Chunk_buildMesh(src, mode, &data);
+        *quads += data.vertices.size / 4;
+        *drawCalls += data.vertices.size > 0;
+        data.vertices.destroy(&data.vertices);
+    }
+    return now() - t0;
+}
+
+// average cost of remeshing one chunk, picked at random with faces
+static double Bench_remesh(struct Chunk* chunks, struct ChunkMeshSource* src, ChunkMeshMode mode) {
+    srand(1);
+    int done = 0;
+    double t0 = now();
+    while (done < BENCH_REMESHES) {
+        struct Chunk* chunk = &chunks[rand() % (BENCH_SIDE * BENCH_SIDE)];
+        if (Chunk_skipsMeshing(chunk))
+            continue;
+        struct ChunkMeshData data;
+        Chunk_snapshot(chunk, src);
+        Chunk_buildMesh(src, mode, &data);
+        data.vertices.destroy(&data.vertices);
+        done++;
+    }
+    return (now() - t0) / BENCH_REMESHES;
+}
+
+int main(void) {
+    int count = BENCH_SIDE * BENCH_SIDE;
+    struct Vec2* positions = (struct Vec2*)malloc(count * sizeof(struct Vec2));
+    struct Chunk* chunks = (struct Chunk*)malloc(count * sizeof(struct Chunk));
+    struct ChunkMeshSource* src = (struct ChunkMeshSource*)malloc(sizeof(struct ChunkMeshSource));
+    struct WorldGenerator generator = WorldGenerator.new(1337);
+
+    for (int z = 0; z < BENCH_SIDE; z++) {
+        for (int x = 0; x < BENCH_SIDE; x++) {
+            int i = x + z * BENCH_SIDE;
+            positions[i] = Vec2.new(x, z);
+            chunks[i] = Chunk.new(&positions[i]);
+            generator.generate(&generator, &chunks[i]);
+        }
+    }
+    // link the grid so faces between chunks are culled like in a World
+    for (int z = 0; z < BENCH_SIDE; z++) {
+        for (int x = 0; x < BENCH_SIDE; x++) {
+            struct Chunk* chunk = &chunks[x + z * BENCH_SIDE];
+            if (x + 1 < BENCH_SIDE) Chunk_setNeighbor(chunk, 3, &chunks[x + 1 + z * BENCH_SIDE]);
+            if (z + 1 < BENCH_SIDE) Chunk_setNeighbor(chunk, 0, &chunks[x + (z + 1) * BENCH_SIDE]);
+        }
+    }
+
+    printf("chunk %dx%dx%d, %d chunks over %dx%d blocks\n",
+           CHUNK_SIZE, CHUNK_HEIGHT, CHUNK_SIZE, count, BENCH_AREA, BENCH_AREA);
+    static const char* names[2] = {"naive", "greedy"};
+    for (int mode = CHUNK_MESH_NAIVE; mode <= CHUNK_MESH_GREEDY; mode++) {
+        long quads;
+        int drawCalls;
+        double all = Bench_meshAll(chunks, src, (ChunkMeshMode)mode, &quads, &drawCalls);
+        double one = Bench_remesh(chunks, src, (ChunkMeshMode)mode);
+        printf("  %-6s area %8.2f ms  remesh %8.1f us/chunk  %8ld quads  %5d draw calls\n",
+               names[mode], all * 1e3, one * 1e6, quads, drawCalls);
+    }
+
+    for (int i = 0; i < count; i++) {
+        Chunk_unlinkNeighbors(&chunks[i]);
+        Chunk_releaseBlocks(&chunks[i]);
+    }
+    generator.destroy(&generator);
+    free(src);
+    free(chunks);
+    free(positions);
+    return 0;
+}
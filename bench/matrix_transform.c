@@ -0,0 +1,158 @@
+// Per-object cost of building a model matrix: the old path, which composed
+// translate * rotate x * rotate y * rotate z * scale out of temporary 4x4
+// products, against mat4_transform's closed form. Also times one chained
+// 4x4 multiply both ways. Needs nothing but Matrix4.h:
+//
+//   gcc -std=gnu11 -O2 -Isrc/main bench/matrix_transform.c -o matrix_transform -lm
+//   ./matrix_transform
+//
+// Add -DMATRIX_NO_SIMD to time the scalar kernels.
+#include <stdlib.h>
+#include <time.h>
+#include "Matrix4.h"
+
+// the previous Matrix4.h composition, kept here as the baseline
+struct OldMat4 {
+    float m[16];
+};
+
+static inline void old_identity(struct OldMat4* this) {
+    static const float id[16] = {
+        1,0,0,0,
+        0,1,0,0,
+        0,0,1,0,
+        0,0,0,1
+    };
+    memcpy(this->m, id, sizeof(id));
+}
+
+static inline void old_set(struct OldMat4* this, int x, int y, float value) {
+    this->m[y*4+x] = value;
+}
+
+static inline void old_multiply(struct OldMat4* this, struct OldMat4* other) {
+    float temp[16] = {0};
+    for (int row = 0; row < 4; row++) {
+        for (int col = 0; col < 4; col++) {
+            for (int k = 0; k < 4; k++) {
+                temp[row*4+col] += this->m[row*4+k] * other->m[k*4+col];
+            }
+        }
+    }
+    memcpy(this->m, temp, sizeof(temp));
+}
+
+static inline void old_translate(struct OldMat4* this, float x, float y, float z) {
+    struct OldMat4 t;
+    old_identity(&t);
+    old_set(&t, 3,0,x);
+    old_set(&t, 3,1,y);
+    old_set(&t, 3,2,z);
+    old_multiply(this, &t);
+}
+
+static inline void old_scale(struct OldMat4* this, float sx, float sy, float sz) {
+    struct OldMat4 s;
+    old_identity(&s);
+    old_set(&s, 0,0,sx);
+    old_set(&s, 1,1,sy);
+    old_set(&s, 2,2,sz);
+    old_multiply(this, &s);
+}
+
+static inline void old_rotate(struct OldMat4* this, float x, float y, float z, float angle) {
+    float rad = angle * (float)M_PI / 180.0f;
+    float co = cosf(rad);
+    float si = sinf(rad);
+    float C  = 1.0f - co;
+
+    struct OldMat4 r;
+    old_identity(&r);
+    old_set(&r, 0,0, co + x*x*C);
+    old_set(&r, 0,1, x*y*C - z*si);
+    old_set(&r, 0,2, x*z*C + y*si);
+
+    old_set(&r, 1,0, y*x*C + z*si);
+    old_set(&r, 1,1, co + y*y*C);
+    old_set(&r, 1,2, y*z*C - x*si);
+
+    old_set(&r, 2,0, z*x*C - y*si);
+    old_set(&r, 2,1, z*y*C + x*si);
+    old_set(&r, 2,2, co + z*z*C);
+
+    old_multiply(this, &r);
+}
+
+static inline void old_transform(struct OldMat4* this, float x, float y, float z,
+                                 float rx, float ry, float rz,
+                                 float sx, float sy, float sz) {
+    old_identity(this);
+    old_translate(this, x, y, z);
+    old_rotate(this, 1,0,0, rx);
+    old_rotate(this, 0,1,0, ry);
+    old_rotate(this, 0,0,1, rz);
+    old_scale(this, sx, sy, sz);
+}
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+// keeps the compiler from dropping or hoisting the work on m
+#define BENCH_USE(m) __asm__ volatile("" : : "r"(m) : "memory")
+
+int main(void) {
+    enum { N = 1 << 22 };
+    double t0;
+
+    // both paths must build the same matrix
+    struct OldMat4 a;
+    struct Mat4 b;
+    old_transform(&a, 1, 2, 3, 10, 20, 30, 0.5f, 2, 1.5f);
+    mat4_transform(&b, 1, 2, 3, 10, 20, 30, 0.5f, 2, 1.5f);
+    float diff = 0;
+    for (int i = 0; i < 16; i++)
+        diff = fmaxf(diff, fabsf(a.m[i] - b.m[i]));
+
+    t0 = now();
+    for (int i = 0; i < N; i++) {
+        struct OldMat4 m;
+        old_transform(&m, (float)i, 1, 2, i * 0.01f, 3, 4, 0.5f, 0.5f, 0.5f);
+        BENCH_USE(m.m);
+    }
+    double trsOld = (now() - t0) / N * 1e9;
+
+    t0 = now();
+    for (int i = 0; i < N; i++) {
+        struct Mat4 m;
+        mat4_transform(&m, (float)i, 1, 2, i * 0.01f, 3, 4, 0.5f, 0.5f, 0.5f);
+        BENCH_USE(m.m);
+    }
+    double trsNew = (now() - t0) / N * 1e9;
+
+    struct OldMat4 oa, ob;
+    old_transform(&oa, 0, 0, 0, 0, 0, 0, 1, 1, 1);
+    old_transform(&ob, 1, 2, 3, 10, 20, 30, 1, 1, 1);
+    t0 = now();
+    for (int i = 0; i < N; i++) {
+        old_multiply(&oa, &ob);
+        BENCH_USE(oa.m);
+    }
+    double mulOld = (now() - t0) / N * 1e9;
+
+    struct Mat4 na = mat4_new(), nb;
+    mat4_transform(&nb, 1, 2, 3, 10, 20, 30, 1, 1, 1);
+    t0 = now();
+    for (int i = 0; i < N; i++) {
+        mat4_multiply(&na, &nb);
+        BENCH_USE(na.m);
+    }
+    double mulNew = (now() - t0) / N * 1e9;
+
+    printf("max difference %g\n", diff);
+    printf("TRS matrix      old %6.1f ns  mat4_transform %6.1f ns\n", trsOld, trsNew);
+    printf("4x4 multiply    old %6.1f ns  mat4_multiply  %6.1f ns\n", mulOld, mulNew);
+    return 0;
+}
@@ -33,8 +33,8 @@ struct Camera {
 };
 
 static void Camera_moveForward(struct Camera* this, float amount) {
-    float x = (float) sin(rad(this->rotation.getY(&this->rotation))) * amount;
-    float z = (float) cos(rad(this->rotation.getY(&this->rotation))) * amount;
+    float x = (float) sin(rad(this->rotation.y)) * amount;
+    float z = (float) cos(rad(this->rotation.y)) * amount;
     this->position.x+=(0-x);
     this->position.z+=(0-z);
 }
@@ -56,7 +56,7 @@ static void Camera_rotate(struct Camera* this, float pitch, float yaw) {
 
 static void Camera_apply(struct Camera* this, struct Program* prog) {
     struct Mat4 view = Mat4.new();
-    view.view(&view,
+    mat4_view(&view,
               this->position.x, this->position.y, this->position.z,
               this->rotation.x, this->rotation.y, this->rotation.z);
 
@@ -5,6 +5,9 @@
 #include "Vec.h"
 #include "Vector.h"
 #include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
 // Face normals
 static const float FACE_NORMALS[6][3] = {
@@ -54,35 +57,396 @@ static inline struct Vec2 getFaceUV(int v) {
     return Vec2.new(CUBE_FACE_UVS[v][0], CUBE_FACE_UVS[v][1]);
 }
 
+// Chunk dimensions are fixed at compile time. Define CHUNK_SIZE (x and z)
+// and optionally CHUNK_HEIGHT (y, defaults to CHUNK_SIZE) before including
+// this header. Both must be 8, 16, 32 or 64 so indexing compiles down to
+// shifts and every column fits one 64-bit mask in the mesher.
+#ifndef CHUNK_SIZE
 #define CHUNK_SIZE 8
-#define CHUNK_VOLUME (CHUNK_SIZE * CHUNK_SIZE * CHUNK_SIZE)
+#endif
+#ifndef CHUNK_HEIGHT
+#define CHUNK_HEIGHT CHUNK_SIZE
+#endif
+
+#define CHUNK_LOG2(n) ((n) == 8 ? 3 : (n) == 16 ? 4 : (n) == 32 ? 5 : (n) == 64 ? 6 : -1)
+#if CHUNK_LOG2(CHUNK_SIZE) < 0 || CHUNK_LOG2(CHUNK_HEIGHT) < 0
+#error "CHUNK_SIZE and CHUNK_HEIGHT must be 8, 16, 32 or 64"
+#endif
+#define CHUNK_SIZE_SHIFT CHUNK_LOG2(CHUNK_SIZE)
+#define CHUNK_HEIGHT_SHIFT CHUNK_LOG2(CHUNK_HEIGHT)
+
+#define CHUNK_VOLUME (CHUNK_SIZE * CHUNK_HEIGHT * CHUNK_SIZE)
+#define CHUNK_MAX_DIM (CHUNK_SIZE > CHUNK_HEIGHT ? CHUNK_SIZE : CHUNK_HEIGHT)
+
+// 0 = air, 1..CHUNK_BLOCK_MAX solid. The packed mesh vertex has 6 bits for
+// the id, so writes of larger ids are rejected rather than wrapped
+typedef uint8_t Block;
+#define CHUNK_BLOCK_MAX 63
+#define CHUNK_INDEX(x, y, z) ((x) | ((y) << CHUNK_SIZE_SHIFT) | ((z) << (CHUNK_SIZE_SHIFT + CHUNK_HEIGHT_SHIFT)))
+
+// extent along block axis 0 = x, 1 = y, 2 = z
+static const int CHUNK_DIMS[3] = {CHUNK_SIZE, CHUNK_HEIGHT, CHUNK_SIZE};
+
+#ifdef CHUNK_PALETTE_STORAGE
+// Palette-compressed blocks, opt in by defining CHUNK_PALETTE_STORAGE.
+// Each voxel stores an index into a per-chunk palette, packed into 64-bit
+// words at 1, 2 or 4 bits. The width grows as new block types show up;
+// past 16 types indices are 8 bits wide and hold the block id itself.
+// A chunk of a single type (all air, all stone) has no words at all.
+// Go through Chunk_blockAt/Chunk_storeBlock, the mesher decodes the chunk
+// back into a dense array once per snapshot.
+#define CHUNK_PALETTE_MAX 16
+
+struct ChunkPalette {
+    uint64_t* words;             // NULL while bits == 0
+    Block palette[CHUNK_PALETTE_MAX];
+    uint8_t size;                // palette entries in use
+    uint8_t bits;                // 0 = single value palette[0], else 1/2/4/8
+};
+
+// log2 of an index width, valid for 1, 2, 4 and 8
+#define CHUNK_PALETTE_SHIFT(bits) ((bits) == 1 ? 0 : (bits) == 2 ? 1 : (bits) == 4 ? 2 : 3)
+
+static inline int ChunkPalette_index(const struct ChunkPalette* p, int i) {
+    int shift = CHUNK_PALETTE_SHIFT(p->bits);
+    uint64_t word = p->words[i >> (6 - shift)];
+    int bit = (i & ((64 >> shift) - 1)) << shift;
+    return (int)(word >> bit) & ((1 << p->bits) - 1);
+}
+
+static inline Block ChunkPalette_get(const struct ChunkPalette* p, int i) {
+    if (p->bits == 0) return p->palette[0];
+    int index = ChunkPalette_index(p, i);
+    return (p->bits == 8) ? (Block)index : p->palette[index];
+}
+
+static inline void ChunkPalette_putIndex(struct ChunkPalette* p, int i, int index) {
+    int shift = CHUNK_PALETTE_SHIFT(p->bits);
+    uint64_t* word = &p->words[i >> (6 - shift)];
+    int bit = (i & ((64 >> shift) - 1)) << shift;
+    uint64_t mask = (((uint64_t)1 << p->bits) - 1) << bit;
+    *word = (*word & ~mask) | ((uint64_t)index << bit);
+}
+
+// re-encode every voxel at a new index width; palette entries keep their slot
+static void ChunkPalette_resize(struct ChunkPalette* p, int bits) {
+    struct ChunkPalette old = *p;
+    p->bits = bits;
+    p->words = (uint64_t*)calloc((CHUNK_VOLUME * bits) / 64, sizeof(uint64_t));
+    for (int i = 0; i < CHUNK_VOLUME; i++) {
+        int index = (old.bits == 0) ? 0 : ChunkPalette_index(&old, i);
+        if (bits == 8 && old.bits != 8) index = old.palette[index];
+        ChunkPalette_putIndex(p, i, index);
+    }
+    free(old.words);
+}
+
+static void ChunkPalette_set(struct ChunkPalette* p, int i, Block block) {
+    if (p->bits == 8) {
+        ChunkPalette_putIndex(p, i, block);
+        return;
+    }
+    int index = 0;
+    while (index < p->size && p->palette[index] != block)
+        index++;
+    if (index == p->size) {
+        if (p->size == CHUNK_PALETTE_MAX) {
+            ChunkPalette_resize(p, 8);
+            ChunkPalette_putIndex(p, i, block);
+            return;
+        }
+        p->palette[p->size++] = block;
+        int needed = (p->size <= 2) ? 1 : (p->size <= 4) ? 2 : 4;
+        if (needed > p->bits)
+            ChunkPalette_resize(p, needed);
+    }
+    if (p->bits == 0) return; // single value and it matched
+    ChunkPalette_putIndex(p, i, index);
+}
+
+static void ChunkPalette_decode(const struct ChunkPalette* p, Block* out) {
+    if (p->bits == 0) {
+        memset(out, p->palette[0], CHUNK_VOLUME);
+        return;
+    }
+    int shift = CHUNK_PALETTE_SHIFT(p->bits);
+    int perWord = 64 >> shift;
+    uint64_t mask = ((uint64_t)1 << p->bits) - 1;
+    for (int w = 0; w < (CHUNK_VOLUME >> (6 - shift)); w++) {
+        uint64_t word = p->words[w];
+        Block* dst = out + w * perWord;
+        for (int k = 0; k < perWord; k++, word >>= p->bits)
+            dst[k] = (p->bits == 8) ? (Block)(word & mask) : p->palette[word & mask];
+    }
+}
+
+// drop palette entries no voxel uses anymore and shrink the index width,
+// down to the single-value form when only one type is left
+static void ChunkPalette_compact(struct ChunkPalette* p) {
+    if (p->bits == 0) return;
+    Block* dense = (Block*)malloc(CHUNK_VOLUME);
+    ChunkPalette_decode(p, dense);
+    uint8_t used[256] = {0};
+    int types = 0;
+    for (int i = 0; i < CHUNK_VOLUME; i++)
+        if (!used[dense[i]]) { used[dense[i]] = 1; types++; }
+
+    free(p->words);
+    p->words = NULL;
+    p->bits = 0;
+    p->size = 1;
+    p->palette[0] = dense[0];
+    if (types > 1) {
+        p->size = 0;
+        for (int i = 0; i < CHUNK_VOLUME; i++)
+            ChunkPalette_set(p, i, dense[i]);
+    }
+    free(dense);
+}
+
+static void ChunkPalette_destroy(struct ChunkPalette* p) {
+    free(p->words);
+    p->words = NULL;
+    p->bits = 0;
+    p->size = 1;
+    p->palette[0] = 0;
+}
 
-typedef uint8_t Block; // 0 = air, >0 = solid
-#define CHUNK_INDEX(x, y, z) ((x) + (y) * CHUNK_SIZE + (z) * CHUNK_SIZE * CHUNK_SIZE)
+// heap bytes behind the indices, the palette itself lives in the chunk
+static inline int ChunkPalette_bytes(const struct ChunkPalette* p) {
+    return (CHUNK_VOLUME * p->bits) / 8;
+}
+#endif
 
 struct Chunk;
 
 struct Model (*ChunkMeshFunc)(struct Chunk* this);
 
+typedef enum {
+    CHUNK_MESH_NAIVE = 0,  // one quad per visible face
+    CHUNK_MESH_GREEDY = 1, // coplanar faces of one block type merged into rectangles
+} ChunkMeshMode;
+
+// filled in by the mesher on every meshify call
+struct ChunkMeshStats {
+    int facesIn;  // visible block faces found
+    int quadsOut; // quads actually emitted
+};
+
 struct Chunk {
+#ifdef CHUNK_PALETTE_STORAGE
+    struct ChunkPalette blocks;
+#else
     Block blocks[CHUNK_VOLUME];
+#endif
     struct Model mesh;
     struct Model (*meshify)(struct Chunk* this);
     struct Vec2* position;
+    ChunkMeshMode meshMode;
+    struct ChunkMeshStats stats;
+
+    // occupancy, kept current by Chunk_storeBlock
+    int solidCount;   // non-air voxels
+    int faceSolid[6]; // non-air voxels in the boundary layer on each side
+    uint16_t connectivity; // face pairs joined through air, see Chunk_facePairBit; set at mesh time
+    int solidFloor;        // completely solid layers from y = 0 up, set at mesh time
+    int solidTop;          // one above the highest non-air layer, set at mesh time
+
+    // adjacent chunks indexed by face direction (NULL = nothing loaded there).
+    // position.x grows towards RIGHT, position.y towards FRONT.
+    struct Chunk* neighbors[6];
+    int dirty; // mesh is out of date with blocks or neighbors
+    unsigned int meshRequest; // bumped per async mesh submit, older results are dropped
+
+    // ChunkDirtyQueue link
+    int queued;
+    struct Chunk* nextDirty;
+
+    void* owner; // container's record for this chunk (World: its WorldChunk)
+    int batchPage, batchPages; // ChunkBatch arena pages holding the mesh, batchPages 0 = none
+    int unsaved; // blocks differ from what a RegionStore holds
+};
+
+// raw block access by CHUNK_INDEX, no dirty tracking (see Chunk_setBlock)
+static inline Block Chunk_blockAt(const struct Chunk* this, int i) {
+#ifdef CHUNK_PALETTE_STORAGE
+    return ChunkPalette_get(&this->blocks, i);
+#else
+    return this->blocks[i];
+#endif
+}
+
+// voxels in the boundary layer on side dir
+#define CHUNK_FACE_AREA(dir) ((dir) < 4 ? CHUNK_SIZE * CHUNK_HEIGHT : CHUNK_SIZE * CHUNK_SIZE)
+
+// add delta (+1/-1) to the occupancy counts for the voxel at index i
+static inline void Chunk_countSolid(struct Chunk* this, int i, int delta) {
+    int x = i & (CHUNK_SIZE - 1);
+    int y = (i >> CHUNK_SIZE_SHIFT) & (CHUNK_HEIGHT - 1);
+    int z = i >> (CHUNK_SIZE_SHIFT + CHUNK_HEIGHT_SHIFT);
+    this->solidCount += delta;
+    if (z == CHUNK_SIZE - 1)   this->faceSolid[0] += delta;
+    if (z == 0)                this->faceSolid[1] += delta;
+    if (x == 0)                this->faceSolid[2] += delta;
+    if (x == CHUNK_SIZE - 1)   this->faceSolid[3] += delta;
+    if (y == CHUNK_HEIGHT - 1) this->faceSolid[4] += delta;
+    if (y == 0)                this->faceSolid[5] += delta;
+}
+
+// returns 0 and leaves the block alone if the id is above CHUNK_BLOCK_MAX
+static inline int Chunk_storeBlock(struct Chunk* this, int i, Block block) {
+    if (block > CHUNK_BLOCK_MAX) return 0;
+    Block old = Chunk_blockAt(this, i);
+    if ((old != 0) != (block != 0))
+        Chunk_countSolid(this, i, block ? 1 : -1);
+#ifdef CHUNK_PALETTE_STORAGE
+    ChunkPalette_set(&this->blocks, i, block);
+#else
+    this->blocks[i] = block;
+#endif
+    return 1;
+}
+
+// rebuild the occupancy counts after writing blocks behind storeBlock's back
+static void Chunk_recountBlocks(struct Chunk* this) {
+    this->solidCount = 0;
+    memset(this->faceSolid, 0, sizeof(this->faceSolid));
+    for (int i = 0; i < CHUNK_VOLUME; i++)
+        if (Chunk_blockAt(this, i))
+            Chunk_countSolid(this, i, 1);
+}
+
+// all blocks as a dense CHUNK_INDEX array
+static void Chunk_copyBlocks(const struct Chunk* this, Block* out) {
+#ifdef CHUNK_PALETTE_STORAGE
+    ChunkPalette_decode(&this->blocks, out);
+#else
+    memcpy(out, this->blocks, CHUNK_VOLUME);
+#endif
+}
+
+// replace every block from a dense CHUNK_INDEX array; no dirty tracking.
+// Returns 0 and keeps the old blocks if any id is above CHUNK_BLOCK_MAX
+static int Chunk_fillBlocks(struct Chunk* this, const Block* blocks) {
+    for (int i = 0; i < CHUNK_VOLUME; i++)
+        if (blocks[i] > CHUNK_BLOCK_MAX) return 0;
+#ifdef CHUNK_PALETTE_STORAGE
+    ChunkPalette_destroy(&this->blocks);
+    for (int i = 0; i < CHUNK_VOLUME; i++)
+        ChunkPalette_set(&this->blocks, i, blocks[i]);
+    ChunkPalette_compact(&this->blocks);
+#else
+    memcpy(this->blocks, blocks, CHUNK_VOLUME);
+#endif
+    Chunk_recountBlocks(this);
+    return 1;
+}
+
+// bytes of block storage held by the chunk
+static inline int Chunk_blockBytes(const struct Chunk* this) {
+#ifdef CHUNK_PALETTE_STORAGE
+    return (int)sizeof(this->blocks) + ChunkPalette_bytes(&this->blocks);
+#else
+    return (int)sizeof(this->blocks);
+#endif
+}
+
+// free block storage of a chunk that is being unloaded
+static inline void Chunk_releaseBlocks(struct Chunk* this) {
+#ifdef CHUNK_PALETTE_STORAGE
+    ChunkPalette_destroy(&this->blocks);
+#else
+    (void)this;
+#endif
+}
+
+// Chunks waiting for a remesh. A chunk is listed once however many edits
+// hit it, so a frame's worth of setBlock calls costs one remesh per chunk.
+static struct {
+    struct Chunk* head;
+} ChunkDirtyQueue;
+
+static void Chunk_markDirty(struct Chunk* this) {
+    this->dirty = 1;
+    if (this->queued) return;
+    this->queued = 1;
+    this->nextDirty = ChunkDirtyQueue.head;
+    ChunkDirtyQueue.head = this;
+}
+
+// next queued chunk, or NULL; its dirty flag is left for the caller
+static struct Chunk* Chunk_popDirty(void) {
+    struct Chunk* c = ChunkDirtyQueue.head;
+    if (!c) return NULL;
+    ChunkDirtyQueue.head = c->nextDirty;
+    c->nextDirty = NULL;
+    c->queued = 0;
+    return c;
+}
+
+static void Chunk_dequeueDirty(struct Chunk* this) {
+    if (!this->queued) return;
+    struct Chunk** link = &ChunkDirtyQueue.head;
+    while (*link && *link != this)
+        link = &(*link)->nextDirty;
+    if (*link) *link = this->nextDirty;
+    this->nextDirty = NULL;
+    this->queued = 0;
+}
+
+// which block axis (0 = x, 1 = y, 2 = z) a face normal points along
+static inline int faceAxis(int dir) {
+    return (dir <= 1) ? 2 : (dir <= 3) ? 0 : 1;
+}
+
+static inline int oppositeFace(int dir) {
+    return dir ^ 1;
+}
+
+// padded border: copy of the neighbor block layer touching each face,
+// indexed by the two in-plane axes ((axis+1)%3, (axis+2)%3)
+struct ChunkBorder {
+    uint8_t present[6];
+    Block slices[6][CHUNK_SIZE * CHUNK_MAX_DIM];
 };
 
-// helper — check face visibility
-static inline int isFaceVisible(struct Chunk* chunk, int x, int y, int z, int dir) {
+static void Chunk_copyBorder(struct Chunk* this, struct ChunkBorder* out) {
+    for (int dir = 0; dir < 6; dir++) {
+        struct Chunk* n = this->neighbors[dir];
+        out->present[dir] = n != NULL;
+        if (!n) continue;
+
+        int a = faceAxis(dir);
+        int u = (a + 1) % 3;
+        int v = (a + 2) % 3;
+        int p[3];
+        p[a] = (FACE_NORMALS[dir][a] > 0) ? 0 : CHUNK_DIMS[a] - 1;
+        for (int j = 0; j < CHUNK_DIMS[v]; j++) {
+            for (int i = 0; i < CHUNK_DIMS[u]; i++) {
+                p[u] = i; p[v] = j;
+                out->slices[dir][i + j * CHUNK_DIMS[u]] = Chunk_blockAt(n, CHUNK_INDEX(p[0], p[1], p[2]));
+            }
+        }
+    }
+}
+
+// helper — check face visibility; border may be NULL (chunk edges always visible)
+static inline int isFaceVisible(const Block* blocks, const struct ChunkBorder* border, int x, int y, int z, int dir) {
     int nx = x + (int)FACE_NORMALS[dir][0];
     int ny = y + (int)FACE_NORMALS[dir][1];
     int nz = z + (int)FACE_NORMALS[dir][2];
 
     if (nx < 0 || ny < 0 || nz < 0 ||
-        nx >= CHUNK_SIZE || ny >= CHUNK_SIZE || nz >= CHUNK_SIZE)
-        return 1; // visible at edge
+        nx >= CHUNK_SIZE || ny >= CHUNK_HEIGHT || nz >= CHUNK_SIZE) {
+        if (!border || !border->present[dir])
+            return 1; // visible at edge
+        int a = faceAxis(dir);
+        int p[3] = {x, y, z};
+        return border->slices[dir][p[(a + 1) % 3] + p[(a + 2) % 3] * CHUNK_DIMS[(a + 1) % 3]] == 0;
+    }
 
     int nIndex = CHUNK_INDEX(nx, ny, nz);
-    return chunk->blocks[nIndex] == 0;
+    return blocks[nIndex] == 0;
 }
 
 // Vec3 add helper
@@ -90,89 +454,530 @@ static inline struct Vec3 Vec3_add(struct Vec3 a, struct Vec3 b) {
     return Vec3.new(a.x + b.x, a.y + b.y, a.z + b.z);
 }
 
-// meshing
-static struct Model meshifyChunk(struct Chunk* this) {
-    struct Vector vertices = Vector.new(0, FIELD_TYPE_VEC3);
-    struct Vector normals  = Vector.new(0, FIELD_TYPE_VEC3);
-    struct Vector uvs      = Vector.new(0, FIELD_TYPE_VEC2);
-    struct Vector indices  = Vector.new(0, FIELD_TYPE_INT);
-    
-    int indexOffset = 0;
+// Packed chunk vertex, one uint32 (decoded by src/shaders/chunk.vert):
+//   bits  0-6   x       0..64
+//   bits  7-13  y       0..64
+//   bits 14-20  z       0..64
+//   bits 21-23  face    FRONT..BOTTOM
+//   bits 24-25  corner  index into CUBE_FACE_UVS
+//   bits 26-31  block   0..CHUNK_BLOCK_MAX
+// UVs are not stored, the shader tiles the atlas cell of the block across the
+// face from the position, which also covers merged greedy quads.
+static inline uint32_t Chunk_packVertex(int x, int y, int z, int face, int corner, int block) {
+    return (uint32_t)x
+         | (uint32_t)y << 7
+         | (uint32_t)z << 14
+         | (uint32_t)face << 21
+         | (uint32_t)corner << 24
+         | (uint32_t)block << 26;
+}
+
+// Meshing runs in two stages so the CPU part can leave the GL thread:
+//   Chunk_snapshot + Chunk_buildMesh*   any thread, touches only the source
+//   Chunk_uploadMesh                    GL thread
+// The source is a private copy of the blocks and the neighbor border.
+struct ChunkMeshSource {
+    Block blocks[CHUNK_VOLUME];
+    struct ChunkBorder border;
+};
 
-    const int atlasN = 2; // 2x2 atlas (4 textures)
-    const float atlasSize = 1.0f / (float)atlasN;
+struct ChunkMeshData {
+    struct Vector vertices; // packed, 4 per quad
+    struct ChunkMeshStats stats;
+    uint16_t connectivity;
+    int solidFloor, solidTop;
+};
+
+static void Chunk_snapshot(struct Chunk* this, struct ChunkMeshSource* out) {
+    Chunk_copyBlocks(this, out->blocks);
+    Chunk_copyBorder(this, &out->border);
+}
+
+// upload packed quad vertices, or an empty model when there is nothing to draw
+static struct Model Chunk_loadPackedMesh(struct Vector* vertices) {
+    struct Model model = Model.new();
+    if (vertices->size == 0)
+        return model;
+    struct ModelDataInfo v = ModelDataInfo.new(vertices->data, ENG_PACKED, vertices->size);
+    model.ldPacked(&model, &v, NULL);
+    return model;
+}
+
+// everything a mesh pass learns about the chunk besides the vertices
+static void Chunk_applyMeshData(struct Chunk* this, const struct ChunkMeshData* data) {
+    this->stats = data->stats;
+    this->connectivity = data->connectivity;
+    this->solidFloor = data->solidFloor;
+    this->solidTop = data->solidTop;
+}
+
+// GL stage: write built mesh data into the chunk's model, frees the data.
+// A chunk that already has GPU buffers keeps them and gets a sub-update.
+static struct Model Chunk_uploadMesh(struct Chunk* this, struct ChunkMeshData* data) {
+    if (this->mesh.vaoID == 0) {
+        this->mesh = Chunk_loadPackedMesh(&data->vertices);
+    } else {
+        struct ModelDataInfo v = ModelDataInfo.new(data->vertices.data, ENG_PACKED, data->vertices.size);
+        this->mesh.updatePacked(&this->mesh, &v);
+    }
+    Chunk_applyMeshData(this, data);
+    data->vertices.destroy(&data->vertices);
+    return this->mesh;
+}
+
+// binary face masks
+//
+// Occupancy is kept as one 64-bit word per column along each axis, so a
+// whole column of visible faces falls out of one shift and one AND:
+//     +dir: solid & ~(solid >> 1 | neighbor << (N - 1))
+//     -dir: solid & ~(solid << 1 | neighbor)
+// The face bits are then transposed into per-slice planes (one word per row)
+// that the greedy pass consumes.
+typedef uint64_t ChunkColumn;
+
+// width set bits starting at bit start
+static inline ChunkColumn columnRun(int start, int width) {
+    return ((width == 64) ? ~(ChunkColumn)0 : (((ChunkColumn)1 << width) - 1)) << start;
+}
+
+struct ChunkFaceMasks {
+    // planes[dir][layer][v] bit u = face visible at (u, v) of that slice,
+    // with u/v being the ((axis+1)%3, (axis+2)%3) in-plane axes
+    ChunkColumn planes[6][CHUNK_MAX_DIM][CHUNK_MAX_DIM];
+    int faceCount;
+
+    // scratch: columns[axis][u][v] bit a = block solid
+    ChunkColumn columns[3][CHUNK_MAX_DIM][CHUNK_MAX_DIM];
+};
+
+static void Chunk_buildFaceMasks(const Block* blocks, const struct ChunkBorder* border, struct ChunkFaceMasks* out) {
+    ChunkColumn (*columns)[CHUNK_MAX_DIM][CHUNK_MAX_DIM] = out->columns;
+    memset(out->columns, 0, sizeof(out->columns));
+    memset(out->planes, 0, sizeof(out->planes));
+    out->faceCount = 0;
 
     for (int z = 0; z < CHUNK_SIZE; z++) {
-        for (int y = 0; y < CHUNK_SIZE; y++) {
+        for (int y = 0; y < CHUNK_HEIGHT; y++) {
             for (int x = 0; x < CHUNK_SIZE; x++) {
-                int i = CHUNK_INDEX(x, y, z);
-                int blockType = this->blocks[i];
-                if (blockType == 0) continue; // air
+                if (blocks[CHUNK_INDEX(x, y, z)] == 0) continue;
+                columns[0][y][z] |= (ChunkColumn)1 << x;
+                columns[1][z][x] |= (ChunkColumn)1 << y;
+                columns[2][x][y] |= (ChunkColumn)1 << z;
+            }
+        }
+    }
+
+    for (int dir = 0; dir < 6; dir++) {
+        int a = faceAxis(dir);
+        int du = CHUNK_DIMS[(a + 1) % 3];
+        int dv = CHUNK_DIMS[(a + 2) % 3];
+        int positive = FACE_NORMALS[dir][a] > 0;
+        ChunkColumn full = columnRun(0, CHUNK_DIMS[a]);
+        const Block* slice = (border && border->present[dir]) ? border->slices[dir] : NULL;
+
+        for (int v = 0; v < dv; v++) {
+            for (int u = 0; u < du; u++) {
+                ChunkColumn solid = columns[a][u][v];
+                if (!solid) continue;
+                ChunkColumn neighbor = (slice && slice[u + v * du] != 0);
+                ChunkColumn faces = positive
+                    ? solid & ~((solid >> 1) | (neighbor << (CHUNK_DIMS[a] - 1)))
+                    : solid & ~((solid << 1) | neighbor) & full;
+
+                out->faceCount += __builtin_popcountll(faces);
+                while (faces) {
+                    int layer = __builtin_ctzll(faces);
+                    out->planes[dir][layer][v] |= (ChunkColumn)1 << u;
+                    faces &= faces - 1;
+                }
+            }
+        }
+    }
+}
+
+// naive meshing from the face masks: one quad per set face bit, found with
+// ctz row by row, so only visible faces are ever visited
+static void Chunk_buildMeshNaive(const struct ChunkMeshSource* src, struct ChunkMeshData* out) {
+    const Block* blocks = src->blocks;
+    // 9 * CHUNK_MAX_DIM^2 words, kept off the stack
+    struct ChunkFaceMasks* masks = malloc(sizeof(struct ChunkFaceMasks));
+    Chunk_buildFaceMasks(blocks, &src->border, masks);
+    struct Vector vertices = Vector.new(masks->faceCount * 4, FIELD_TYPE_UINT);
+    uint32_t* verts = (uint32_t*)vertices.data;
+
+    for (int dir = 0; dir < 6; dir++) {
+        int a = faceAxis(dir);
+        int u = (a + 1) % 3;
+        int v = (a + 2) % 3;
+        int p[3];
+        for (int d = 0; d < CHUNK_DIMS[a]; d++) {
+            const ChunkColumn* plane = masks->planes[dir][d];
+            p[a] = d;
+            for (int j = 0; j < CHUNK_DIMS[v]; j++) {
+                ChunkColumn row = plane[j];
+                p[v] = j;
+                while (row) {
+                    p[u] = __builtin_ctzll(row);
+                    row &= row - 1;
+                    int blockType = blocks[CHUNK_INDEX(p[0], p[1], p[2])];
+                    for (int c = 0; c < 4; c++)
+                        verts[vertices.size++] = Chunk_packVertex(
+                            p[0] + (int)CUBE_FACE_VERTS[dir][c][0],
+                            p[1] + (int)CUBE_FACE_VERTS[dir][c][1],
+                            p[2] + (int)CUBE_FACE_VERTS[dir][c][2],
+                            dir, c, blockType);
+                }
+            }
+        }
+    }
+
+    out->vertices = vertices;
+    out->stats.facesIn = vertices.size / 4;
+    out->stats.quadsOut = vertices.size / 4;
+    free(masks);
+}
 
-                // compute UV offset in the atlas
-                int tx = blockType % atlasN;
-                int ty = blockType / atlasN;
-                float uOffset = tx * atlasSize;
-                float vOffset = ty * atlasSize;
+// greedy meshing
+//
+// Each face plane is grown into the largest rectangles of a single block
+// type. Texture tiling over merged quads is left to the chunk shader.
+
+static void Chunk_buildMeshGreedy(const struct ChunkMeshSource* src, struct ChunkMeshData* out) {
+    struct Vector vertices = Vector.new(0, FIELD_TYPE_UINT);
+    const Block* blocks = src->blocks;
+
+    // 9 * CHUNK_MAX_DIM^2 words, kept off the stack
+    struct ChunkFaceMasks* masks = malloc(sizeof(struct ChunkFaceMasks));
+    Chunk_buildFaceMasks(blocks, &src->border, masks);
+
+    for (int dir = 0; dir < 6; dir++) {
+        // a = slice axis, u/v = the two axes spanning the face
+        int a = faceAxis(dir);
+        int u = (a + 1) % 3;
+        int v = (a + 2) % 3;
+
+        for (int d = 0; d < CHUNK_DIMS[a]; d++) {
+            ChunkColumn* plane = masks->planes[dir][d];
+            int p[3];
+            p[a] = d;
+
+            for (int j = 0; j < CHUNK_DIMS[v]; j++) {
+                while (plane[j]) {
+                    int i = __builtin_ctzll(plane[j]);
+                    p[u] = i; p[v] = j;
+                    int blockType = blocks[CHUNK_INDEX(p[0], p[1], p[2])];
+
+                    // widest run of set bits, cut short where the block type changes
+                    int w = 1;
+                    while (i + w < CHUNK_DIMS[u] && (plane[j] >> (i + w)) & 1) {
+                        p[u] = i + w;
+                        if (blocks[CHUNK_INDEX(p[0], p[1], p[2])] != blockType) break;
+                        w++;
+                    }
+                    ChunkColumn run = columnRun(i, w);
+
+                    // extend down while the next row has the whole run set and of the same type
+                    int h = 1;
+                    for (; j + h < CHUNK_DIMS[v]; h++) {
+                        if ((plane[j + h] & run) != run) break;
+                        p[v] = j + h;
+                        int k = 0;
+                        for (; k < w; k++) {
+                            p[u] = i + k;
+                            if (blocks[CHUNK_INDEX(p[0], p[1], p[2])] != blockType) break;
+                        }
+                        if (k < w) break;
+                    }
 
-                for (int dir = 0; dir < 6; dir++) {
-                    if (!isFaceVisible(this, x, y, z, dir))
-                        continue;
+                    for (int l = 0; l < h; l++)
+                        plane[j + l] &= ~run;
 
-                    struct Vec3 base = Vec3.new(x, y, z);
-                    struct Vec3 normal = getFaceNormal(dir);
+                    int base[3], extent[3];
+                    base[a] = d;   extent[a] = 1;
+                    base[u] = i;   extent[u] = w;
+                    base[v] = j;   extent[v] = h;
 
-                    for (int v = 0; v < 4; v++) {
-                        struct Vec3 vert = Vec3_add(getFaceVertex(dir, v), base);
+                    for (int c = 0; c < 4; c++) {
+                        uint32_t vert = Chunk_packVertex(
+                            base[0] + (int)CUBE_FACE_VERTS[dir][c][0] * extent[0],
+                            base[1] + (int)CUBE_FACE_VERTS[dir][c][1] * extent[1],
+                            base[2] + (int)CUBE_FACE_VERTS[dir][c][2] * extent[2],
+                            dir, c, blockType);
                         vertices.push_back(&vertices, &vert);
-                        normals.push_back(&normals, &normal);
-
-                        struct Vec2 uvBase = getFaceUV(v);
-                        struct Vec2 uv = Vec2.new(
-                            uvBase.x * atlasSize + uOffset,
-                            uvBase.y * atlasSize + vOffset
-                        );
-                        uvs.push_back(&uvs, &uv);
                     }
+                }
+            }
+        }
+    }
 
-                    int inds[6] = {0, 1, 2, 2, 1, 3};
-                    for (int j = 0; j < 6; j++) {
-                        int idx = indexOffset + inds[j];
-                        indices.push_back(&indices, &idx);
-                    }
+    out->vertices = vertices;
+    out->stats.facesIn = masks->faceCount;
+    out->stats.quadsOut = vertices.size / 4;
+    free(masks);
+}
 
-                    indexOffset += 4;
-                }
+// Cave connectivity: one bit per unordered pair of faces, set when some
+// run of air cells inside the chunk touches both. A visibility walk can
+// then only leave a chunk through a face that is joined to the one it
+// came in by, which hides whatever sits behind solid rock.
+#define CHUNK_CONNECT_ALL 0x7FFF // 15 pairs
+
+static inline int Chunk_facePairBit(int a, int b) {
+    if (a > b) { int t = a; a = b; b = t; }
+    return 1 << (a * (11 - a) / 2 + (b - a - 1));
+}
+
+static inline int Chunk_canSeeThrough(const struct Chunk* this, int from, int to) {
+    return from != to && (this->connectivity & Chunk_facePairBit(from, to)) != 0;
+}
+
+// faces of the chunk boundary a cell lies on, as a bit per face direction
+static inline int Chunk_cellFaces(int x, int y, int z) {
+    int faces = 0;
+    if (z == CHUNK_SIZE - 1)   faces |= 1 << 0;
+    if (z == 0)                faces |= 1 << 1;
+    if (x == 0)                faces |= 1 << 2;
+    if (x == CHUNK_SIZE - 1)   faces |= 1 << 3;
+    if (y == CHUNK_HEIGHT - 1) faces |= 1 << 4;
+    if (y == 0)                faces |= 1 << 5;
+    return faces;
+}
+
+static uint16_t Chunk_facePairs(int faces) {
+    uint16_t pairs = 0;
+    for (int a = 0; a < 6; a++) {
+        if (!(faces & (1 << a))) continue;
+        for (int b = a + 1; b < 6; b++)
+            if (faces & (1 << b))
+                pairs |= Chunk_facePairBit(a, b);
+    }
+    return pairs;
+}
+
+// flood fill every air region once and join the faces each one reaches
+static uint16_t Chunk_computeConnectivity(const Block* blocks) {
+    int* stack = malloc(CHUNK_VOLUME * sizeof(int));
+    uint8_t* seen = calloc(CHUNK_VOLUME, 1);
+    uint16_t connectivity = 0;
+    for (int start = 0; start < CHUNK_VOLUME && connectivity != CHUNK_CONNECT_ALL; start++) {
+        if (seen[start] || blocks[start] != 0) continue;
+        int faces = 0;
+        int top = 0;
+        stack[top++] = start;
+        seen[start] = 1;
+        while (top > 0) {
+            int i = stack[--top];
+            int x = i & (CHUNK_SIZE - 1);
+            int y = (i >> CHUNK_SIZE_SHIFT) & (CHUNK_HEIGHT - 1);
+            int z = i >> (CHUNK_SIZE_SHIFT + CHUNK_HEIGHT_SHIFT);
+            faces |= Chunk_cellFaces(x, y, z);
+            for (int dir = 0; dir < 6; dir++) {
+                int nx = x + (int)FACE_NORMALS[dir][0];
+                int ny = y + (int)FACE_NORMALS[dir][1];
+                int nz = z + (int)FACE_NORMALS[dir][2];
+                if (nx < 0 || ny < 0 || nz < 0 ||
+                    nx >= CHUNK_SIZE || ny >= CHUNK_HEIGHT || nz >= CHUNK_SIZE)
+                    continue;
+                int n = CHUNK_INDEX(nx, ny, nz);
+                if (seen[n] || blocks[n] != 0) continue;
+                seen[n] = 1;
+                stack[top++] = n;
             }
         }
+        connectivity |= Chunk_facePairs(faces);
+    }
+    free(seen);
+    free(stack);
+    return connectivity;
+}
+
+// vertical extent of the blocks: tight bounds for occlusion tests, and the
+// solid floor as a box other chunks can be hidden behind
+static void Chunk_measureLayers(const Block* blocks, int* solidFloor, int* solidTop) {
+    const int layer = CHUNK_SIZE * CHUNK_SIZE;
+    int floor = 0, top = 0;
+    int solidBelow = 1;
+    for (int y = 0; y < CHUNK_HEIGHT; y++) {
+        int solid = 0;
+        for (int z = 0; z < CHUNK_SIZE; z++)
+            for (int x = 0; x < CHUNK_SIZE; x++)
+                solid += blocks[CHUNK_INDEX(x, y, z)] != 0;
+        if (solid > 0)
+            top = y + 1;
+        if (solidBelow && solid == layer)
+            floor = y + 1;
+        else
+            solidBelow = 0;
     }
+    *solidFloor = floor;
+    *solidTop = top;
+}
 
-    struct ModelDataInfo v  = ModelDataInfo.new(vertices.data, ENG_VEC3, vertices.size);
-    struct ModelDataInfo uv = ModelDataInfo.new(uvs.data, ENG_VEC2, uvs.size);
-    struct ModelDataInfo n  = ModelDataInfo.new(normals.data, ENG_VEC3, normals.size);
-    struct ModelDataInfo i  = ModelDataInfo.new(indices.data, ENG_INT, indices.size);
+static void Chunk_buildMesh(const struct ChunkMeshSource* src, ChunkMeshMode mode, struct ChunkMeshData* out) {
+    if (mode == CHUNK_MESH_GREEDY)
+        Chunk_buildMeshGreedy(src, out);
+    else
+        Chunk_buildMeshNaive(src, out);
+    out->connectivity = Chunk_computeConnectivity(src->blocks);
+    Chunk_measureLayers(src->blocks, &out->solidFloor, &out->solidTop);
+}
 
-    struct Model model = Model.new();
-    if (vertices.size == 0) {
-        return Model.new(); // empty model
+static inline int Chunk_isEmpty(const struct Chunk* this) {
+    return this->solidCount == 0;
+}
+
+// solid all the way through and walled in by solid neighbor layers, so
+// not a single face can be seen
+static int Chunk_isBuried(const struct Chunk* this) {
+    if (this->solidCount != CHUNK_VOLUME) return 0;
+    for (int dir = 0; dir < 6; dir++) {
+        const struct Chunk* n = this->neighbors[dir];
+        if (!n || n->faceSolid[oppositeFace(dir)] != CHUNK_FACE_AREA(dir))
+            return 0;
     }
+    return 1;
+}
 
-    model.ld(&model, &v, &i, &uv, &n);
+// Empty and buried chunks never produce quads. Their mesh is cleared
+// without a snapshot or a mesher pass; GPU buffers are kept for reuse.
+static inline int Chunk_skipsMeshing(const struct Chunk* this) {
+    return Chunk_isEmpty(this) || Chunk_isBuried(this);
+}
 
-    vertices.destroy(&vertices);
-    normals.destroy(&normals);
-    uvs.destroy(&uvs);
-    indices.destroy(&indices);
+static void Chunk_clearMesh(struct Chunk* this) {
+    this->mesh.vertexCount = 0;
+    this->mesh.indexCount = 0;
+    this->stats = (struct ChunkMeshStats){0};
+    // skipped chunks are all air or all solid
+    this->connectivity = Chunk_isEmpty(this) ? CHUNK_CONNECT_ALL : 0;
+    this->solidFloor = this->solidTop = Chunk_isEmpty(this) ? 0 : CHUNK_HEIGHT;
+}
 
-    return model;
+// synchronous meshify: both stages on the calling (GL) thread
+static struct Model Chunk_meshNow(struct Chunk* this, ChunkMeshMode mode) {
+    if (Chunk_skipsMeshing(this)) {
+        Chunk_clearMesh(this);
+        return this->mesh;
+    }
+    struct ChunkMeshSource* src = malloc(sizeof(struct ChunkMeshSource));
+    struct ChunkMeshData data;
+    Chunk_snapshot(this, src);
+    Chunk_buildMesh(src, mode, &data);
+    free(src);
+    return Chunk_uploadMesh(this, &data);
+}
+
+static struct Model meshifyChunk(struct Chunk* this) {
+    return Chunk_meshNow(this, CHUNK_MESH_NAIVE);
+}
+
+static struct Model meshifyChunkGreedy(struct Chunk* this) {
+    return Chunk_meshNow(this, CHUNK_MESH_GREEDY);
+}
+
+// switch which mesher chunk.meshify runs
+static inline void Chunk_setMeshMode(struct Chunk* this, ChunkMeshMode mode) {
+    this->meshMode = mode;
+    this->meshify = (mode == CHUNK_MESH_GREEDY) ? &meshifyChunkGreedy : &meshifyChunk;
+}
+
+
+// link two adjacent chunks; other sits on the dir side of this.
+// Both meshes go stale since their shared boundary faces change.
+static void Chunk_setNeighbor(struct Chunk* this, int dir, struct Chunk* other) {
+    this->neighbors[dir] = other;
+    Chunk_markDirty(this);
+    if (other) {
+        other->neighbors[oppositeFace(dir)] = this;
+        Chunk_markDirty(other);
+    }
+}
+
+// detach a chunk before unloading it, neighbors get their boundary faces back
+static void Chunk_unlinkNeighbors(struct Chunk* this) {
+    for (int dir = 0; dir < 6; dir++) {
+        struct Chunk* n = this->neighbors[dir];
+        if (!n) continue;
+        n->neighbors[oppositeFace(dir)] = NULL;
+        Chunk_markDirty(n);
+        this->neighbors[dir] = NULL;
+    }
+    Chunk_dequeueDirty(this);
+}
+
+// call after writing to blocks; only neighbors whose touching layer could
+// differ are invalidated when the edit position is known, pass x = -1 otherwise
+static void Chunk_markChanged(struct Chunk* this, int x, int y, int z) {
+    Chunk_markDirty(this);
+    this->unsaved = 1;
+    for (int dir = 0; dir < 6; dir++) {
+        struct Chunk* n = this->neighbors[dir];
+        if (!n) continue;
+        if (x >= 0) {
+            int p[3] = {x, y, z};
+            int a = faceAxis(dir);
+            int edge = (FACE_NORMALS[dir][a] > 0) ? CHUNK_DIMS[a] - 1 : 0;
+            if (p[a] != edge) continue;
+        }
+        Chunk_markDirty(n);
+    }
+}
+
+static inline Block Chunk_getBlock(struct Chunk* this, int x, int y, int z) {
+    return Chunk_blockAt(this, CHUNK_INDEX(x, y, z));
+}
+
+// edit one block; the remesh is deferred to Chunk_flushDirty (or
+// ChunkMesher.flushDirty) so repeated edits in a frame coalesce.
+// Returns 0 if the id is above CHUNK_BLOCK_MAX and nothing was written
+static inline int Chunk_setBlock(struct Chunk* this, int x, int y, int z, Block block) {
+    int i = CHUNK_INDEX(x, y, z);
+    if (Chunk_blockAt(this, i) == block) return 1;
+    if (!Chunk_storeBlock(this, i, block)) return 0;
+    Chunk_markChanged(this, x, y, z);
+    return 1;
+}
+
+// rebuild this chunk's mesh and any neighbor invalidated along with it
+static inline void Chunk_remeshDirty(struct Chunk* this) {
+    if (this->dirty) {
+        this->mesh = this->meshify(this);
+        this->dirty = 0;
+    }
+    for (int dir = 0; dir < 6; dir++) {
+        struct Chunk* n = this->neighbors[dir];
+        if (n && n->dirty) {
+            n->mesh = n->meshify(n);
+            n->dirty = 0;
+        }
+    }
 }
 
+// remesh every queued chunk once, returns how many were rebuilt
+static inline int Chunk_flushDirty(void) {
+    int count = 0;
+    struct Chunk* c;
+    while ((c = Chunk_popDirty())) {
+        if (!c->dirty) continue;
+        c->mesh = c->meshify(c);
+        c->dirty = 0;
+        count++;
+    }
+    return count;
+}
 
 // constructor
 inline static struct Chunk newChunk(struct Vec2* position) {
     struct Chunk c = {0};
-    c.meshify = &meshifyChunk;
+#ifdef CHUNK_PALETTE_STORAGE
+    c.blocks.size = 1; // all air
+#endif
+    c.mesh = Model.new();
     c.position = position;
+    Chunk_setMeshMode(&c, CHUNK_MESH_NAIVE);
+    c.connectivity = CHUNK_CONNECT_ALL; // see-through until the first mesh says otherwise
+    c.solidTop = CHUNK_HEIGHT;
+    c.dirty = 1;
     return c;
 }
 
@@ -206,15 +1011,12 @@ struct Model Chunk_generateFlatPlane(void) {
     struct Vector vertices = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector normals  = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector uvs      = Vector.new(0, FIELD_TYPE_VEC2);
-    struct Vector indices  = Vector.new(0, FIELD_TYPE_INT);
 
     const int TILE_COUNT_X = 256;
     const int TILE_COUNT_Z = TILE_COUNT_X;
     const float TILE_SIZE = 1.0f;
     const float TILE_SCALE = 1.0f;  // how often texture repeats
 
-    int indexOffset = 0;
-
     for (int z = 0; z < TILE_COUNT_Z; z++) {
         for (int x = 0; x < TILE_COUNT_X; x++) {
             float x0 = x * TILE_SIZE;
@@ -251,29 +1053,19 @@ struct Model Chunk_generateFlatPlane(void) {
             uvs.push_back(&uvs, &uv1);
             uvs.push_back(&uvs, &uv2);
             uvs.push_back(&uvs, &uv3);
-
-            int inds[6] = {0, 1, 2, 2, 1, 3};
-            for (int i = 0; i < 6; i++) {
-                int idx = indexOffset + inds[i];
-                indices.push_back(&indices, &idx);
-            }
-
-            indexOffset += 4;
         }
     }
 
     struct ModelDataInfo v  = ModelDataInfo.new(vertices.data, ENG_VEC3, vertices.size);
     struct ModelDataInfo uv = ModelDataInfo.new(uvs.data, ENG_VEC2, uvs.size);
     struct ModelDataInfo n  = ModelDataInfo.new(normals.data, ENG_VEC3, normals.size);
-    struct ModelDataInfo i  = ModelDataInfo.new(indices.data, ENG_INT, indices.size);
 
     struct Model model = Model.new();
-    model.ld(&model, &v, &i, &uv, &n);
+    model.ld(&model, &v, NULL, &uv, &n); // quads, shared index buffer
 
     vertices.destroy(&vertices);
     normals.destroy(&normals);
     uvs.destroy(&uvs);
-    indices.destroy(&indices);
 
     return model;
 }
@@ -294,7 +1086,6 @@ struct Model Chunk_generateTexturePlaneSEE(const char* idMapPath) {
     struct Vector vertices = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector normals  = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector uvs      = Vector.new(0, FIELD_TYPE_VEC2);
-    struct Vector indices  = Vector.new(0, FIELD_TYPE_INT);
 
     const float TILE_SIZE = 1.0f;
     const float HEIGHT = 0.0f; // flat plane
@@ -302,8 +1093,6 @@ struct Model Chunk_generateTexturePlaneSEE(const char* idMapPath) {
     const int atlasN = 2;             // atlas is 2x2 tiles
     const float tileSize = 1.0f / atlasN;
 
-    int indexOffset = 0;
-
     for (int z = 0; z < height - 1; z++) {
         for (int x = 0; x < width - 1; x++) {
 
@@ -345,29 +1134,19 @@ struct Model Chunk_generateTexturePlaneSEE(const char* idMapPath) {
             uvs.push_back(&uvs, &uv1);
             uvs.push_back(&uvs, &uv2);
             uvs.push_back(&uvs, &uv3);
-
-            // indices
-            int inds[6] = {0, 1, 2, 2, 1, 3};
-            for (int i = 0; i < 6; i++) {
-                int idx = indexOffset + inds[i];
-                indices.push_back(&indices, &idx);
-            }
-            indexOffset += 4;
         }
     }
 
     struct ModelDataInfo v  = ModelDataInfo.new(vertices.data, ENG_VEC3, vertices.size);
     struct ModelDataInfo uv = ModelDataInfo.new(uvs.data, ENG_VEC2, uvs.size);
     struct ModelDataInfo n  = ModelDataInfo.new(normals.data, ENG_VEC3, normals.size);
-    struct ModelDataInfo i  = ModelDataInfo.new(indices.data, ENG_INT, indices.size);
 
     struct Model model = Model.new();
-    model.ld(&model, &v, &i, &uv, &n);
+    model.ld(&model, &v, NULL, &uv, &n); // quads, shared index buffer
 
     vertices.destroy(&vertices);
     normals.destroy(&normals);
     uvs.destroy(&uvs);
-    indices.destroy(&indices);
 
     return model;
 }
@@ -391,7 +1170,6 @@ struct Model Chunk_generateHeightmapPlaneSE( const char* heightmapPath,int* terr
     struct Vector vertices = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector normals  = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector uvs      = Vector.new(0, FIELD_TYPE_VEC2);
-    struct Vector indices  = Vector.new(0, FIELD_TYPE_INT);
 
     const float TILE_SIZE = 1.0f;
     const float HEIGHT_SCALE = 30.0f;
@@ -400,8 +1178,6 @@ struct Model Chunk_generateHeightmapPlaneSE( const char* heightmapPath,int* terr
     const float tileSize = 1.0f / atlasN;
     const float uvRepeat = 1.0f;      // 1 = each tile uses full atlas cell
 
-    int indexOffset = 0;
-
     for (int z = 0; z < height - 1; z++) {
         for (int x = 0; x < width - 1; x++) {
 
@@ -456,30 +1232,20 @@ struct Model Chunk_generateHeightmapPlaneSE( const char* heightmapPath,int* terr
             uvs.push_back(&uvs, &uv1);
             uvs.push_back(&uvs, &uv2);
             uvs.push_back(&uvs, &uv3);
-
-            // --- indices ---
-            int inds[6] = {0, 1, 2, 2, 1, 3};
-            for (int i = 0; i < 6; i++) {
-                int idx = indexOffset + inds[i];
-                indices.push_back(&indices, &idx);
-            }
-            indexOffset += 4;
         }
     }
 
     struct ModelDataInfo v  = ModelDataInfo.new(vertices.data, ENG_VEC3, vertices.size);
     struct ModelDataInfo uv = ModelDataInfo.new(uvs.data, ENG_VEC2, uvs.size);
     struct ModelDataInfo n  = ModelDataInfo.new(normals.data, ENG_VEC3, normals.size);
-    struct ModelDataInfo i  = ModelDataInfo.new(indices.data, ENG_INT, indices.size);
 
     struct Model model = Model.new();
-    model.ld(&model, &v, &i, &uv, &n);
+    model.ld(&model, &v, NULL, &uv, &n); // quads, shared index buffer
 
     //free(heightData);
     vertices.destroy(&vertices);
     normals.destroy(&normals);
     uvs.destroy(&uvs);
-    indices.destroy(&indices);
 
     return model;
 }
@@ -492,7 +1258,6 @@ struct Model Chunk_generateHeightmapPlaneS(const char* heightmapPath, int* terra
     struct Vector vertices = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector normals  = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector uvs      = Vector.new(0, FIELD_TYPE_VEC2);
-    struct Vector indices  = Vector.new(0, FIELD_TYPE_INT);
 
     const float TILE_SIZE = 1.0f;
     const float HEIGHT_SCALE = 45.0f; // mountains height
@@ -500,8 +1265,6 @@ struct Model Chunk_generateHeightmapPlaneS(const char* heightmapPath, int* terra
     const float tileSize = 1.0f / atlasN;
     const float uvRepeat = 1.0f;      // repeats per tile
 
-    int indexOffset = 0;
-
     for (int z = 0; z < height - 1; z++) {
         for (int x = 0; x < width - 1; x++) {
             // heights
@@ -554,29 +1317,20 @@ struct Model Chunk_generateHeightmapPlaneS(const char* heightmapPath, int* terra
             uvs.push_back(&uvs, &uv1);
             uvs.push_back(&uvs, &uv2);
             uvs.push_back(&uvs, &uv3);
-
-            // indices
-            int inds[6] = {0, 1, 2, 2, 1, 3};
-            for (int i = 0; i < 6; i++) {
-                indices.push_back(&indices, &(int){indexOffset + inds[i]});
-            }
-            indexOffset += 4;
         }
     }
 
     struct ModelDataInfo v  = ModelDataInfo.new(vertices.data, ENG_VEC3, vertices.size);
     struct ModelDataInfo uv = ModelDataInfo.new(uvs.data, ENG_VEC2, uvs.size);
     struct ModelDataInfo n  = ModelDataInfo.new(normals.data, ENG_VEC3, normals.size);
-    struct ModelDataInfo i  = ModelDataInfo.new(indices.data, ENG_INT, indices.size);
 
     struct Model model = Model.new();
-    model.ld(&model, &v, &i, &uv, &n);
+    model.ld(&model, &v, NULL, &uv, &n); // quads, shared index buffer
 
     free(heightData);
     vertices.destroy(&vertices);
     normals.destroy(&normals);
     uvs.destroy(&uvs);
-    indices.destroy(&indices);
 
     return model;
 }
@@ -592,7 +1346,6 @@ struct Model Chunk_generateHeightmapPlaneN(const char* heightmapPath) {
     struct Vector vertices = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector normals  = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector uvs      = Vector.new(0, FIELD_TYPE_VEC2);
-    struct Vector indices  = Vector.new(0, FIELD_TYPE_INT);
 
     const float TILE_SIZE = 1.0f;
     const float HEIGHT_SCALE = 130.0f;
@@ -600,8 +1353,6 @@ struct Model Chunk_generateHeightmapPlaneN(const char* heightmapPath) {
     const float tileSize = 1.0f / atlasN;
     const float uvRepeat = 8.0f;   // how many times texture repeats over the terrain
 
-    int indexOffset = 0;
-
     for (int z = 0; z < height - 1; z++) {
         for (int x = 0; x < width - 1; x++) {
             float y00 = heightData[z * width + x] * HEIGHT_SCALE;
@@ -652,29 +1403,20 @@ struct Model Chunk_generateHeightmapPlaneN(const char* heightmapPath) {
             uvs.push_back(&uvs, &uv1);
             uvs.push_back(&uvs, &uv2);
             uvs.push_back(&uvs, &uv3);
-
-            int inds[6] = {0, 1, 2, 2, 1, 3};
-            for (int i = 0; i < 6; i++) {
-                int v = (indexOffset + inds[i]);
-                indices.push_back(&indices, (void*)&v);
-            }
-            indexOffset += 4;
         }
     }
 
     struct ModelDataInfo v  = ModelDataInfo.new(vertices.data, ENG_VEC3, vertices.size);
     struct ModelDataInfo uv = ModelDataInfo.new(uvs.data, ENG_VEC2, uvs.size);
     struct ModelDataInfo n  = ModelDataInfo.new(normals.data, ENG_VEC3, normals.size);
-    struct ModelDataInfo i  = ModelDataInfo.new(indices.data, ENG_INT, indices.size);
 
     struct Model model = Model.new();
-    model.ld(&model, &v, &i, &uv, &n);
+    model.ld(&model, &v, NULL, &uv, &n); // quads, shared index buffer
 
     free(heightData);
     vertices.destroy(&vertices);
     normals.destroy(&normals);
     uvs.destroy(&uvs);
-    indices.destroy(&indices);
 
     return model;
 }
@@ -687,13 +1429,10 @@ struct Model Chunk_generateHeightmapPlane(const char* heightmapPath) {
     struct Vector vertices = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector normals  = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector uvs      = Vector.new(0, FIELD_TYPE_VEC2);
-    struct Vector indices  = Vector.new(0, FIELD_TYPE_INT);
 
     const float TILE_SIZE = 2.0f;
     const float HEIGHT_SCALE = 30.0f; // adjust for how tall mountains are
 
-    int indexOffset = 0;
-
     for (int z = 0; z < height - 1; z++) {
         for (int x = 0; x < width - 1; x++) {
             float y00 = heightData[z * width + x] * HEIGHT_SCALE;
@@ -747,60 +1486,130 @@ struct Model Chunk_generateHeightmapPlane(const char* heightmapPath) {
             uvs.push_back(&uvs, &uv1);
             uvs.push_back(&uvs, &uv2);
             uvs.push_back(&uvs, &uv3);
-
-            int inds[6] = {0, 1, 2, 2, 1, 3};
-            for (int i = 0; i < 6; i++) {
-                int idx = indexOffset + inds[i];
-                indices.push_back(&indices, &idx);
-            }
-            indexOffset += 4;
         }
     }
 
     struct ModelDataInfo v  = ModelDataInfo.new(vertices.data, ENG_VEC3, vertices.size);
     struct ModelDataInfo uv = ModelDataInfo.new(uvs.data, ENG_VEC2, uvs.size);
     struct ModelDataInfo n  = ModelDataInfo.new(normals.data, ENG_VEC3, normals.size);
-    struct ModelDataInfo i  = ModelDataInfo.new(indices.data, ENG_INT, indices.size);
 
     struct Model model = Model.new();
-    model.ld(&model, &v, &i, &uv, &n);
+    model.ld(&model, &v, NULL, &uv, &n); // quads, shared index buffer
 
     free(heightData);
     vertices.destroy(&vertices);
     normals.destroy(&normals);
     uvs.destroy(&uvs);
-    indices.destroy(&indices);
 
     return model;
 }
 
-void Chunk_generateTerrain(struct Chunk* this) {
-    // scale height and noise frequency based on chunk size
-    const int MAX_HEIGHT = CHUNK_SIZE / 2;        // top half of chunk used for terrain
-    const float FREQUENCY = 0.05f * (64.0f / CHUNK_SIZE); // keep noise consistent across sizes
-    const float AMPLITUDE = (float)(MAX_HEIGHT - 2);
+// Terrain for an unbounded world of chunks. Noise is sampled in world
+// block coordinates (chunk->position * CHUNK_SIZE + local), so chunks line
+// up with their neighbors and the same seed always yields the same world.
+// After construction nothing is written, generate may run on many threads.
+// generate only fills the chunk's blocks; the thread that owns the chunk
+// list calls Chunk_markChanged(chunk, -1, 0, 0) afterwards.
+#define WORLD_NOISE_DIMENSION 256 // terrain repeats every 256 / frequency blocks
+
+struct WorldGenerator {
+    uint64_t seed;
+    struct PerlinNoise height;
+    struct PerlinNoise caves;
+    float frequency;                  // heightmap lattice cells per block
+    int maxHeight;                    // terrain stays below this y
+    struct PerlinFractal terrain;     // heightmap octaves
+    float caveFrequency;              // 3D lattice cells per block
+    float caveThreshold;              // carve where |cave noise| is below this, 0 = no caves
+    struct PerlinFractal caveFractal;
+    void (*generate)(struct WorldGenerator* this, struct Chunk* chunk);
+    void (*destroy)(struct WorldGenerator* this);
+};
 
-    struct PerlinNoise noise = PerlinNoise.new(CHUNK_SIZE);
+static void WorldGenerator_generate(struct WorldGenerator* this, struct Chunk* chunk) {
+    const float AMPLITUDE = (float)(this->maxHeight - 2);
+    float originX = chunk->position->x * CHUNK_SIZE;
+    float originZ = chunk->position->y * CHUNK_SIZE;
+
+    // whole heightmap in one batch, indexed x + z * CHUNK_SIZE
+    float noise[CHUNK_SIZE * CHUNK_SIZE];
+    this->height.fillGridFractal(&this->height, noise, CHUNK_SIZE, CHUNK_SIZE,
+                                 originX * this->frequency, originZ * this->frequency, this->frequency, this->terrain);
+
+    // cave density for the whole chunk in CHUNK_INDEX order; tunnels run
+    // along the zero set of the noise, so they wind and connect
+    float* density = NULL;
+    if (this->caveThreshold > 0.0f) {
+        float f = this->caveFrequency;
+        density = (float*)malloc(CHUNK_VOLUME * sizeof(float));
+        this->caves.fillVolume(&this->caves, density, CHUNK_SIZE, CHUNK_HEIGHT, CHUNK_SIZE,
+                               originX * f, 0.0f, originZ * f, f, f, this->caveFractal);
+    }
 
     for (int x = 0; x < CHUNK_SIZE; x++) {
         for (int z = 0; z < CHUNK_SIZE; z++) {
-            struct Vec2 samplePos = Vec2.new(x * FREQUENCY, z * FREQUENCY);
-            float n = noise.noiseAt(&noise, samplePos);
+            float n = noise[x + z * CHUNK_SIZE];
             n = (n + 1.0f) * 0.5f; // normalize to 0–1
             int height = (int)(n * AMPLITUDE);
 
-            for (int y = 0; y < CHUNK_SIZE; y++) {
-                if (y < height - 1)
-                    this->blocks[CHUNK_INDEX(x, y, z)] = 4; // deeper solid
+            for (int y = 0; y < CHUNK_HEIGHT; y++) {
+                int i = CHUNK_INDEX(x, y, z);
+                if (density && y > 0 && y < height && fabsf(density[i]) < this->caveThreshold)
+                    Chunk_storeBlock(chunk, i, 0); // cave, the floor layer is never carved
+                else if (y < height - 1)
+                    Chunk_storeBlock(chunk, i, 4); // deeper solid
                 else if (y == height - 1)
-                    this->blocks[CHUNK_INDEX(x, y, z)] = 3; // surface block
+                    Chunk_storeBlock(chunk, i, 3); // surface block
                 else
-                    this->blocks[CHUNK_INDEX(x, y, z)] = 0; // air
+                    Chunk_storeBlock(chunk, i, 0); // air
             }
         }
     }
+    free(density);
+
+#ifdef CHUNK_PALETTE_STORAGE
+    ChunkPalette_compact(&chunk->blocks);
+#endif
+}
+
+static void WorldGenerator_destroy(struct WorldGenerator* this) {
+    this->height.destroy(&this->height);
+    this->caves.destroy(&this->caves);
+}
+
+inline static struct WorldGenerator newWorldGenerator(uint64_t seed) {
+    return (struct WorldGenerator) {
+        .seed = seed,
+        .height = PerlinNoise.seeded(WORLD_NOISE_DIMENSION, seed),
+        .caves = PerlinNoise.seeded(WORLD_NOISE_DIMENSION, seed ^ 0xCA7E5ull),
+        .frequency = 0.1f,             // per block, independent of chunk size
+        .maxHeight = CHUNK_HEIGHT / 2, // top half of chunk used for terrain
+        .terrain = { .octaves = 3, .lacunarity = 2.0f, .gain = 0.5f },
+        .caveFrequency = 0.12f,
+        .caveThreshold = 0.05f,
+        .caveFractal = { .octaves = 2, .lacunarity = 2.0f, .gain = 0.5f },
+        .generate = &WorldGenerator_generate,
+        .destroy = &WorldGenerator_destroy,
+    };
+}
+
+static const struct {
+    struct WorldGenerator (*new)(uint64_t seed);
+} WorldGenerator = { .new = &newWorldGenerator };
+
+// shared generator behind Chunk_generateTerrain, built on first use
+#define WORLD_DEFAULT_SEED 1337
+static struct WorldGenerator ChunkDefaultGenerator;
+static pthread_once_t ChunkDefaultGeneratorOnce = PTHREAD_ONCE_INIT;
 
-    noise.destroy(&noise);
+static void Chunk_initDefaultGenerator(void) {
+    ChunkDefaultGenerator = WorldGenerator.new(WORLD_DEFAULT_SEED);
+}
+
+void Chunk_generateTerrain(struct Chunk* this) {
+    pthread_once(&ChunkDefaultGeneratorOnce, &Chunk_initDefaultGenerator);
+    ChunkDefaultGenerator.generate(&ChunkDefaultGenerator, this);
+    Chunk_markChanged(this, -1, 0, 0);
 }
 
 
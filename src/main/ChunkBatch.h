@@ -0,0 +1,287 @@
+#ifndef CHUNKBATCH_H_
+#define CHUNKBATCH_H_
+    #include "Chunk.h"
+    #include "Model.h"
+    #include <stdint.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #define GLFW_INCLUDE_NONE
+    #include <GLFW/glfw3.h>
+    #include <glad.h>
+
+    // All chunk meshes in one vertex buffer, drawn with a single call.
+    //
+    // The buffer is split into fixed pages of CHUNK_BATCH_PAGE_QUADS quads; a
+    // chunk owns a run of consecutive pages. A texture buffer holds the world
+    // origin of every page, and the batch vertex shader (chunk_batch.vert)
+    // looks it up with gl_VertexID / CHUNK_BATCH_PAGE_VERTICES. Each draw's
+    // baseVertex is its chunk's first vertex, which gl_VertexID includes, so
+    // no per-draw uniform, draw id or instance attribute is needed. Every
+    // draw reads the shared QuadIndexBuffer from index 0.
+    //
+    // Per frame: begin, add every visible chunk, flush. With GL 4.3 or
+    // ARB_multi_draw_indirect the commands go out as one
+    // glMultiDrawElementsIndirect; older contexts (3.3) use one
+    // glMultiDrawElementsBaseVertex with the same data.
+    #define CHUNK_BATCH_PAGE_QUADS 128
+    #define CHUNK_BATCH_PAGE_VERTICES (CHUNK_BATCH_PAGE_QUADS * 4)
+    #define CHUNK_BATCH_ORIGIN_UNIT 1 // texture unit of the origin buffer, 0 is left to the atlas
+
+    // layout fixed by GL for indirect element draws
+    struct ChunkDrawCommand {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    struct ChunkBatch {
+        GLuint vaoID;
+        GLuint vboID;           // the page arena
+        GLuint originBuffer;    // RGBA32F per page: chunk origin in world space
+        GLuint originTexture;
+        GLuint indirectBuffer;
+        int pageCount;
+        uint8_t* pageUsed;
+        float* origins;         // CPU copy of originBuffer
+        int indirect;           // glMultiDrawElementsIndirect is available
+
+        struct ChunkDrawCommand* commands;
+        int commandCount;
+        int commandCapacity;
+        GLsizei* counts;        // fallback path arrays, sized like commands
+        GLint* baseVertices;
+        const void** offsets;
+        int drawCalls;          // GL draw calls issued by the last flush
+
+        void (*store)(struct ChunkBatch* this, struct Chunk* chunk, struct ChunkMeshData* data);
+        void (*release)(struct ChunkBatch* this, struct Chunk* chunk);
+        void (*begin)(struct ChunkBatch* this);
+        void (*add)(struct ChunkBatch* this, struct Chunk* chunk);
+        void (*flush)(struct ChunkBatch* this, struct Program* program);
+        void (*destroy)(struct ChunkBatch* this);
+    };
+
+    // GL objects are made on the first store, so a batch can be created before the context
+    static void ChunkBatch_init(struct ChunkBatch* this) {
+        this->indirect = GLAD_GL_ARB_multi_draw_indirect ||
+                         GLVersion.major > 4 || (GLVersion.major == 4 && GLVersion.minor >= 3);
+        this->pageCount = 64;
+        this->pageUsed = (uint8_t*)calloc(this->pageCount, 1);
+        this->origins = (float*)calloc(this->pageCount * 4, sizeof(float));
+
+        glGenVertexArrays(1, &this->vaoID);
+        glGenBuffers(1, &this->vboID);
+        glBindVertexArray(this->vaoID);
+        glBindBuffer(GL_ARRAY_BUFFER, this->vboID);
+        glBufferData(GL_ARRAY_BUFFER, this->pageCount * CHUNK_BATCH_PAGE_VERTICES * sizeof(uint32_t), NULL, GL_DYNAMIC_DRAW);
+        glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, 0, 0);
+        glEnableVertexAttribArray(0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, QuadIndexBuffer_reserve(CHUNK_BATCH_PAGE_QUADS));
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        glGenBuffers(1, &this->originBuffer);
+        glBindBuffer(GL_TEXTURE_BUFFER, this->originBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, this->pageCount * 4 * sizeof(float), this->origins, GL_DYNAMIC_DRAW);
+        glGenTextures(1, &this->originTexture);
+        glBindTexture(GL_TEXTURE_BUFFER, this->originTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, this->originBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        glGenBuffers(1, &this->indirectBuffer);
+    }
+
+    // double the arena: copy the pages over on the GPU, the VAO is pointed at the new buffer
+    static void ChunkBatch_grow(struct ChunkBatch* this, int minPages) {
+        int count = this->pageCount * 2;
+        while (count < minPages) count *= 2;
+        GLuint vbo;
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, vbo);
+        glBufferData(GL_COPY_WRITE_BUFFER, count * CHUNK_BATCH_PAGE_VERTICES * sizeof(uint32_t), NULL, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_COPY_READ_BUFFER, this->vboID);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0,
+                            this->pageCount * CHUNK_BATCH_PAGE_VERTICES * sizeof(uint32_t));
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glDeleteBuffers(1, &this->vboID);
+        this->vboID = vbo;
+        glBindVertexArray(this->vaoID);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glVertexAttribIPointer(0, 1, GL_UNSIGNED_INT, 0, 0);
+        glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+        this->pageUsed = (uint8_t*)realloc(this->pageUsed, count);
+        memset(this->pageUsed + this->pageCount, 0, count - this->pageCount);
+        this->origins = (float*)realloc(this->origins, count * 4 * sizeof(float));
+        memset(this->origins + this->pageCount * 4, 0, (count - this->pageCount) * 4 * sizeof(float));
+        this->pageCount = count;
+        glBindBuffer(GL_TEXTURE_BUFFER, this->originBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, count * 4 * sizeof(float), this->origins, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // first fit run of free pages, grows the arena when there is none
+    static int ChunkBatch_allocate(struct ChunkBatch* this, int pages) {
+        int run = 0;
+        for (int p = 0; p < this->pageCount; p++) {
+            run = this->pageUsed[p] ? 0 : run + 1;
+            if (run == pages) {
+                int first = p - pages + 1;
+                memset(this->pageUsed + first, 1, pages);
+                return first;
+            }
+        }
+        // a free tail run can be extended into the new space
+        int first = this->pageCount - run;
+        ChunkBatch_grow(this, first + pages);
+        memset(this->pageUsed + first, 1, pages);
+        return first;
+    }
+
+    static void ChunkBatch_release(struct ChunkBatch* this, struct Chunk* chunk) {
+        if (chunk->batchPages > 0)
+            memset(this->pageUsed + chunk->batchPage, 0, chunk->batchPages);
+        chunk->batchPages = 0;
+        chunk->mesh.vertexCount = 0;
+        chunk->mesh.indexCount = 0;
+    }
+
+    // GL stage for batched chunks, the counterpart of Chunk_uploadMesh; frees the data.
+    // A mesh that still fits its pages is rewritten in place and gives back the spare ones.
+    static void ChunkBatch_store(struct ChunkBatch* this, struct Chunk* chunk, struct ChunkMeshData* data) {
+        if (this->vaoID == 0)
+            ChunkBatch_init(this);
+        int quads = data->vertices.size / 4;
+        int pages = (quads + CHUNK_BATCH_PAGE_QUADS - 1) / CHUNK_BATCH_PAGE_QUADS;
+        if (pages <= chunk->batchPages) {
+            memset(this->pageUsed + chunk->batchPage + pages, 0, chunk->batchPages - pages);
+            chunk->batchPages = pages;
+        } else {
+            ChunkBatch_release(this, chunk);
+            chunk->batchPage = ChunkBatch_allocate(this, pages);
+            chunk->batchPages = pages;
+        }
+
+        if (quads > 0) {
+            glBindBuffer(GL_COPY_WRITE_BUFFER, this->vboID);
+            glBufferSubData(GL_COPY_WRITE_BUFFER,
+                            (GLintptr)chunk->batchPage * CHUNK_BATCH_PAGE_VERTICES * sizeof(uint32_t),
+                            data->vertices.size * sizeof(uint32_t), data->vertices.data);
+            glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+            QuadIndexBuffer_reserve(quads);
+
+            for (int p = chunk->batchPage; p < chunk->batchPage + pages; p++) {
+                this->origins[p * 4 + 0] = chunk->position->x * CHUNK_SIZE;
+                this->origins[p * 4 + 1] = 0;
+                this->origins[p * 4 + 2] = chunk->position->y * CHUNK_SIZE;
+            }
+            glBindBuffer(GL_TEXTURE_BUFFER, this->originBuffer);
+            glBufferSubData(GL_TEXTURE_BUFFER, (GLintptr)chunk->batchPage * 4 * sizeof(float),
+                            pages * 4 * sizeof(float), this->origins + chunk->batchPage * 4);
+            glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        }
+        chunk->mesh.vertexCount = quads * 6;
+        chunk->mesh.indexCount = quads * 6;
+        Chunk_applyMeshData(chunk, data);
+        data->vertices.destroy(&data->vertices);
+    }
+
+    static void ChunkBatch_begin(struct ChunkBatch* this) {
+        this->commandCount = 0;
+    }
+
+    static void ChunkBatch_add(struct ChunkBatch* this, struct Chunk* chunk) {
+        if (chunk->batchPages == 0 || chunk->mesh.vertexCount == 0)
+            return;
+        if (this->commandCount == this->commandCapacity) {
+            int capacity = this->commandCapacity ? this->commandCapacity * 2 : 256;
+            this->commands = (struct ChunkDrawCommand*)realloc(this->commands, capacity * sizeof(struct ChunkDrawCommand));
+            this->counts = (GLsizei*)realloc(this->counts, capacity * sizeof(GLsizei));
+            this->baseVertices = (GLint*)realloc(this->baseVertices, capacity * sizeof(GLint));
+            this->offsets = (const void**)realloc(this->offsets, capacity * sizeof(void*));
+            this->commandCapacity = capacity;
+        }
+        this->commands[this->commandCount++] = (struct ChunkDrawCommand){
+            .count = (GLuint)chunk->mesh.vertexCount,
+            .instanceCount = 1,
+            .firstIndex = 0,
+            .baseVertex = chunk->batchPage * CHUNK_BATCH_PAGE_VERTICES,
+            .baseInstance = 0,
+        };
+    }
+
+    // draws everything added since begin; program must be using chunk_batch.vert
+    static void ChunkBatch_flush(struct ChunkBatch* this, struct Program* program) {
+        this->drawCalls = 0;
+        if (this->commandCount == 0 || this->vaoID == 0)
+            return;
+        glUniform1i(glGetUniformLocation(program->getProgramID(program), "chunkOrigins"), CHUNK_BATCH_ORIGIN_UNIT);
+        glActiveTexture(GL_TEXTURE0 + CHUNK_BATCH_ORIGIN_UNIT);
+        glBindTexture(GL_TEXTURE_BUFFER, this->originTexture);
+        glBindVertexArray(this->vaoID);
+        if (this->indirect) {
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, this->indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, this->commandCount * sizeof(struct ChunkDrawCommand),
+                         this->commands, GL_STREAM_DRAW);
+            glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, 0, this->commandCount, 0);
+            glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        } else {
+            for (int i = 0; i < this->commandCount; i++) {
+                this->counts[i] = (GLsizei)this->commands[i].count;
+                this->baseVertices[i] = this->commands[i].baseVertex;
+                this->offsets[i] = NULL; // every draw starts at index 0
+            }
+            glMultiDrawElementsBaseVertex(GL_TRIANGLES, this->counts, GL_UNSIGNED_INT,
+                                          (const void* const*)this->offsets, this->commandCount, this->baseVertices);
+        }
+        this->drawCalls = 1;
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    static void ChunkBatch_destroy(struct ChunkBatch* this) {
+        if (this->vaoID) {
+            glDeleteVertexArrays(1, &this->vaoID);
+            glDeleteBuffers(1, &this->vboID);
+            glDeleteBuffers(1, &this->originBuffer);
+            glDeleteBuffers(1, &this->indirectBuffer);
+            glDeleteTextures(1, &this->originTexture);
+        }
+        free(this->pageUsed);
+        free(this->origins);
+        free(this->commands);
+        free(this->counts);
+        free(this->baseVertices);
+        free(this->offsets);
+        this->vaoID = 0;
+        this->pageUsed = NULL;
+        this->origins = NULL;
+        this->commands = NULL;
+        this->counts = NULL;
+        this->baseVertices = NULL;
+        this->offsets = NULL;
+        this->commandCount = this->commandCapacity = 0;
+    }
+
+    static struct ChunkBatch newChunkBatch() {
+        return (struct ChunkBatch) {
+            .store = &ChunkBatch_store,
+            .release = &ChunkBatch_release,
+            .begin = &ChunkBatch_begin,
+            .add = &ChunkBatch_add,
+            .flush = &ChunkBatch_flush,
+            .destroy = &ChunkBatch_destroy,
+        };
+    }
+
+    static const struct {
+        struct ChunkBatch (*new)();
+    } ChunkBatch = { .new = &newChunkBatch };
+
+#endif
@@ -0,0 +1,212 @@
+#ifndef CHUNKMESHER_H_
+#define CHUNKMESHER_H_
+    #include "Chunk.h"
+    #include "ThreadPool.h"
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <pthread.h>
+    #define GLFW_INCLUDE_NONE
+    #include <GLFW/glfw3.h>
+    #include <glad.h>
+
+    // Background chunk meshing. submit() snapshots the chunk on the calling
+    // thread and hands the CPU stage to the worker pool; upload() runs on the
+    // GL thread once per frame and turns finished meshes into models until
+    // its time budget is used up.
+    struct ChunkMesherState;
+
+    struct ChunkMeshJob {
+        struct Chunk* chunk;
+        unsigned int request; // chunk->meshRequest when submitted
+        int dropped;          // chunk was forgotten, never touch it
+        ChunkMeshMode mode;
+        struct ChunkMeshSource source;
+        struct ChunkMeshData result;
+        struct ChunkMesherState* owner;
+        struct ChunkMeshJob* next;     // done queue
+        struct ChunkMeshJob* outPrev;  // outstanding list
+        struct ChunkMeshJob* outNext;
+    };
+
+    struct ChunkMesherState {
+        struct ThreadPool pool;
+        int ownsPool;
+        pthread_mutex_t lock;
+        pthread_cond_t drained;
+        struct ChunkMeshJob* doneHead;
+        struct ChunkMeshJob* doneTail;
+        struct ChunkMeshJob* outstanding; // submitted, not yet uploaded
+        int building;                     // jobs still on the workers
+        int submitted;
+        int uploaded;
+    };
+
+    struct ChunkMesher {
+        struct ChunkMesherState* state;
+        void (*submit)(struct ChunkMesher* this, struct Chunk* chunk);
+        void (*submitDirty)(struct ChunkMesher* this, struct Chunk* chunk);
+        int (*flushDirty)(struct ChunkMesher* this);
+        int (*upload)(struct ChunkMesher* this, double budgetSeconds);
+        void (*forget)(struct ChunkMesher* this, struct Chunk* chunk);
+        void (*destroy)(struct ChunkMesher* this);
+    };
+
+    static void ChunkMesher_build(void* arg) {
+        struct ChunkMeshJob* job = (struct ChunkMeshJob*)arg;
+        struct ChunkMesherState* s = job->owner;
+        Chunk_buildMesh(&job->source, job->mode, &job->result);
+
+        pthread_mutex_lock(&s->lock);
+        job->next = NULL;
+        if (s->doneTail) s->doneTail->next = job;
+        else s->doneHead = job;
+        s->doneTail = job;
+        s->building--;
+        if (s->building == 0)
+            pthread_cond_broadcast(&s->drained);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    static void ChunkMesher_submit(struct ChunkMesher* this, struct Chunk* chunk) {
+        struct ChunkMesherState* s = this->state;
+        if (Chunk_skipsMeshing(chunk)) {
+            chunk->meshRequest++; // drop results still in flight
+            chunk->dirty = 0;
+            Chunk_clearMesh(chunk);
+            return;
+        }
+        struct ChunkMeshJob* job = (struct ChunkMeshJob*)malloc(sizeof(struct ChunkMeshJob));
+        job->chunk = chunk;
+        job->request = ++chunk->meshRequest;
+        job->dropped = 0;
+        job->mode = chunk->meshMode;
+        job->owner = s;
+        Chunk_snapshot(chunk, &job->source);
+        chunk->dirty = 0;
+
+        pthread_mutex_lock(&s->lock);
+        job->outPrev = NULL;
+        job->outNext = s->outstanding;
+        if (s->outstanding) s->outstanding->outPrev = job;
+        s->outstanding = job;
+        s->building++;
+        s->submitted++;
+        pthread_mutex_unlock(&s->lock);
+
+        s->pool.submit(&s->pool, &ChunkMesher_build, job);
+    }
+
+    // async counterpart of Chunk_remeshDirty
+    static void ChunkMesher_submitDirty(struct ChunkMesher* this, struct Chunk* chunk) {
+        if (chunk->dirty)
+            ChunkMesher_submit(this, chunk);
+        for (int dir = 0; dir < 6; dir++) {
+            struct Chunk* n = chunk->neighbors[dir];
+            if (n && n->dirty)
+                ChunkMesher_submit(this, n);
+        }
+    }
+
+    // async counterpart of Chunk_flushDirty: one job per queued chunk
+    static int ChunkMesher_flushDirty(struct ChunkMesher* this) {
+        int count = 0;
+        struct Chunk* c;
+        while ((c = Chunk_popDirty())) {
+            if (!c->dirty) continue;
+            ChunkMesher_submit(this, c);
+            count++;
+        }
+        return count;
+    }
+
+    // GL thread: upload finished meshes, at least one, then until the budget
+    // runs out. Returns how many jobs were retired.
+    static int ChunkMesher_upload(struct ChunkMesher* this, double budgetSeconds) {
+        struct ChunkMesherState* s = this->state;
+        double start = glfwGetTime();
+        int count = 0;
+        for (;;) {
+            pthread_mutex_lock(&s->lock);
+            struct ChunkMeshJob* job = s->doneHead;
+            if (job) {
+                s->doneHead = job->next;
+                if (!s->doneHead) s->doneTail = NULL;
+                if (job->outPrev) job->outPrev->outNext = job->outNext;
+                else s->outstanding = job->outNext;
+                if (job->outNext) job->outNext->outPrev = job->outPrev;
+            }
+            pthread_mutex_unlock(&s->lock);
+            if (!job) break;
+
+            // a newer submit for the same chunk supersedes this result
+            if (!job->dropped && job->request == job->chunk->meshRequest) {
+                job->chunk->mesh = Chunk_uploadMesh(job->chunk, &job->result);
+                s->uploaded++;
+            } else {
+                job->result.vertices.destroy(&job->result.vertices);
+            }
+            free(job);
+            count++;
+
+            if (glfwGetTime() - start >= budgetSeconds)
+                break;
+        }
+        return count;
+    }
+
+    // call before freeing a chunk that may still have jobs in flight
+    static void ChunkMesher_forget(struct ChunkMesher* this, struct Chunk* chunk) {
+        struct ChunkMesherState* s = this->state;
+        pthread_mutex_lock(&s->lock);
+        for (struct ChunkMeshJob* job = s->outstanding; job; job = job->outNext)
+            if (job->chunk == chunk)
+                job->dropped = 1;
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    static void ChunkMesher_destroy(struct ChunkMesher* this) {
+        struct ChunkMesherState* s = this->state;
+        if (!s) return;
+        pthread_mutex_lock(&s->lock);
+        while (s->building)
+            pthread_cond_wait(&s->drained, &s->lock);
+        pthread_mutex_unlock(&s->lock);
+
+        struct ChunkMeshJob* job = s->doneHead;
+        while (job) {
+            struct ChunkMeshJob* next = job->next;
+            job->result.vertices.destroy(&job->result.vertices);
+            free(job);
+            job = next;
+        }
+        if (s->ownsPool)
+            s->pool.destroy(&s->pool);
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->drained);
+        free(s);
+        this->state = NULL;
+    }
+
+    // pool may be NULL to let the mesher run its own workers
+    static struct ChunkMesher newChunkMesher(struct ThreadPool* pool) {
+        struct ChunkMesherState* s = (struct ChunkMesherState*)calloc(1, sizeof(struct ChunkMesherState));
+        s->ownsPool = pool == NULL;
+        s->pool = pool ? *pool : ThreadPool.new(0);
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_cond_init(&s->drained, NULL);
+        return (struct ChunkMesher) {
+            .state = s,
+            .submit = &ChunkMesher_submit,
+            .submitDirty = &ChunkMesher_submitDirty,
+            .flushDirty = &ChunkMesher_flushDirty,
+            .upload = &ChunkMesher_upload,
+            .forget = &ChunkMesher_forget,
+            .destroy = &ChunkMesher_destroy,
+        };
+    }
+
+    static const struct {
+        struct ChunkMesher (*new)(struct ThreadPool* pool);
+    } ChunkMesher = { .new = &newChunkMesher };
+
+#endif
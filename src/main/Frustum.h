@@ -0,0 +1,152 @@
+#ifndef FRUSTUM_H_
+#define FRUSTUM_H_
+
+#include "Matrix4.h"
+#include "Camera.h"
+#include "OcclusionCuller.h"
+#include <math.h>
+
+// plane order inside Frustum.planes
+#define FRUSTUM_LEFT   0
+#define FRUSTUM_RIGHT  1
+#define FRUSTUM_BOTTOM 2
+#define FRUSTUM_TOP    3
+#define FRUSTUM_NEAR   4
+#define FRUSTUM_FAR    5
+
+// view frustum as six inward facing planes (a,b,c,d): a*x + b*y + c*z + d >= 0 is inside
+// visible/culled count every test since the last extract, so they read as per frame numbers
+struct Frustum {
+    float planes[6][4];
+    float eye[3];   // camera position the view matrix was built from
+    int visible;
+    int culled;
+    int occluded;   // inside the planes but hidden behind rock or occluders
+    struct OcclusionCuller* occlusion; // optional depth test after the planes, NULL = planes only
+
+    void (*extract)(struct Frustum* this, struct Mat4* projection, struct Mat4* view);
+    void (*fromCamera)(struct Frustum* this, struct Mat4* projection, struct Camera* camera);
+    int (*testAABB)(struct Frustum* this, float minX, float minY, float minZ,
+                    float maxX, float maxY, float maxZ);
+    int (*testSphere)(struct Frustum* this, float x, float y, float z, float radius);
+};
+
+// Gribb/Hartmann: the planes are sums and differences of the rows of projection*view.
+// Mat4 is row major with column vectors, so the rows are read straight out of m[]
+static void Frustum_extract(struct Frustum* this, struct Mat4* projection, struct Mat4* view) {
+    struct Mat4 clip;
+    mat4_mul(&clip, projection, view);
+    const float* r0 = &clip.m[0];
+    const float* r1 = &clip.m[4];
+    const float* r2 = &clip.m[8];
+    const float* r3 = &clip.m[12];
+    for (int i = 0; i < 4; i++) {
+        this->planes[FRUSTUM_LEFT][i]   = r3[i] + r0[i];
+        this->planes[FRUSTUM_RIGHT][i]  = r3[i] - r0[i];
+        this->planes[FRUSTUM_BOTTOM][i] = r3[i] + r1[i];
+        this->planes[FRUSTUM_TOP][i]    = r3[i] - r1[i];
+        this->planes[FRUSTUM_NEAR][i]   = r3[i] + r2[i];
+        this->planes[FRUSTUM_FAR][i]    = r3[i] - r2[i];
+    }
+    // normalized so testSphere can compare against a radius
+    for (int p = 0; p < 6; p++) {
+        float* pl = this->planes[p];
+        float len = sqrtf(pl[0]*pl[0] + pl[1]*pl[1] + pl[2]*pl[2]);
+        if (len > 0.0f) {
+            pl[0] /= len; pl[1] /= len; pl[2] /= len; pl[3] /= len;
+        }
+    }
+    // view = R * T(-eye), so eye = -R^T * t
+    const float* v = view->m;
+    for (int i = 0; i < 3; i++)
+        this->eye[i] = -(v[0*4+i]*v[3] + v[1*4+i]*v[7] + v[2*4+i]*v[11]);
+    this->visible = 0;
+    this->culled = 0;
+    this->occluded = 0;
+}
+
+// same view matrix Camera.apply uploads
+static void Frustum_fromCamera(struct Frustum* this, struct Mat4* projection, struct Camera* camera) {
+    struct Mat4 view = Mat4.new();
+    mat4_view(&view,
+              camera->position.x, camera->position.y, camera->position.z,
+              camera->rotation.x, camera->rotation.y, camera->rotation.z);
+    Frustum_extract(this, projection, &view);
+}
+
+// conservative: only rejects a box lying fully behind one plane. the corner
+// furthest along each plane normal is the only one that has to be checked.
+// leaves the counters alone
+static int Frustum_intersectsAABB(const struct Frustum* this, float minX, float minY, float minZ,
+                                  float maxX, float maxY, float maxZ) {
+    for (int p = 0; p < 6; p++) {
+        const float* pl = this->planes[p];
+        float x = pl[0] >= 0.0f ? maxX : minX;
+        float y = pl[1] >= 0.0f ? maxY : minY;
+        float z = pl[2] >= 0.0f ? maxZ : minZ;
+        if (pl[0]*x + pl[1]*y + pl[2]*z + pl[3] < 0.0f)
+            return 0;
+    }
+    return 1;
+}
+
+// after the planes; 1 when there is no occlusion culler
+static inline int Frustum_unoccluded(struct Frustum* this, float minX, float minY, float minZ,
+                                     float maxX, float maxY, float maxZ) {
+    return !this->occlusion || this->occlusion->testAABB(this->occlusion, minX, minY, minZ, maxX, maxY, maxZ);
+}
+
+static int Frustum_testAABB(struct Frustum* this, float minX, float minY, float minZ,
+                            float maxX, float maxY, float maxZ) {
+    if (!Frustum_intersectsAABB(this, minX, minY, minZ, maxX, maxY, maxZ)) {
+        this->culled++;
+        return 0;
+    }
+    if (!Frustum_unoccluded(this, minX, minY, minZ, maxX, maxY, maxZ)) {
+        this->occluded++;
+        return 0;
+    }
+    this->visible++;
+    return 1;
+}
+
+static int Frustum_testSphere(struct Frustum* this, float x, float y, float z, float radius) {
+    for (int p = 0; p < 6; p++) {
+        const float* pl = this->planes[p];
+        if (pl[0]*x + pl[1]*y + pl[2]*z + pl[3] < -radius) {
+            this->culled++;
+            return 0;
+        }
+    }
+    if (!Frustum_unoccluded(this, x - radius, y - radius, z - radius, x + radius, y + radius, z + radius)) {
+        this->occluded++;
+        return 0;
+    }
+    this->visible++;
+    return 1;
+}
+
+static struct Frustum newFrustum() {
+    struct Frustum f = {
+        .planes = {{0}},
+        .eye = {0},
+        .visible = 0,
+        .culled = 0,
+        .occluded = 0,
+        .occlusion = NULL,
+        .extract = &Frustum_extract,
+        .fromCamera = &Frustum_fromCamera,
+        .testAABB = &Frustum_testAABB,
+        .testSphere = &Frustum_testSphere,
+    };
+    // everything passes until the first extract
+    for (int p = 0; p < 6; p++)
+        f.planes[p][3] = 1.0f;
+    return f;
+}
+
+static const struct {
+    struct Frustum (*new)();
+} Frustum = { .new = &newFrustum };
+
+#endif
@@ -526,17 +526,96 @@ static const struct {
 #include <GLFW/glfw3.h>
 #include <glad.h>
 
+#include "Frustum.h"
+#include "TransformStore.h"
+
+// uniform scale useMdl bakes into the model matrix
+#define LOADEDMODEL_SCALE 0.5f
+
 struct LoadedModel {
     struct Model model;
     struct Vec3 pos;
     struct Vec3 rot;
+    // bounding sphere in model space, filled in by loadOBJ
+    struct Vec3 boundsCenter;
+    float boundsRadius;
+    // optional: once tracked, the matrix comes from the store's update and
+    // pos/rot have to change through moveTo
+    struct TransformStore* transforms;
+    int transform;
     void (*use)(struct LoadedModel* this, struct Program *prog);
+    int (*visible)(struct LoadedModel* this, struct Frustum* frustum);
+    void (*draw)(struct LoadedModel* this, struct Program* prog, struct Texture* texture, struct Frustum* frustum);
+    void (*track)(struct LoadedModel* this, struct TransformStore* store);
+    void (*moveTo)(struct LoadedModel* this, struct Vec3 pos, struct Vec3 rot);
 };
+// the store's precomputed matrix when tracked, otherwise built into scratch
+static const struct Mat4* LoadedModel_matrix(struct LoadedModel* this, struct Mat4* scratch) {
+    if (this->transforms)
+        return this->transforms->matrix(this->transforms, this->transform);
+    mat4_transform(scratch, this->pos.x,this->pos.y, this->pos.z,this->rot.x,this->rot.y,this->rot.z,
+                   LOADEDMODEL_SCALE,LOADEDMODEL_SCALE,LOADEDMODEL_SCALE);
+    return scratch;
+}
 void useMdl(struct LoadedModel* this, struct Program *prog) {
-    struct Mat4 mmodel = Mat4.new();
+    struct Mat4 scratch;
     struct Uniform umodel = Uniform.new(GL_MAT4, prog, "model");
-    mmodel.transform(&mmodel, this->pos.x,this->pos.y, this->pos.z,this->rot.x,this->rot.y,this->rot.z,0.5,0.5,0.5);
-    umodel.ld(&umodel, (void*)&mmodel);
+    umodel.ld(&umodel, (void*)LoadedModel_matrix(this, &scratch));
+}
+// moves the sphere into world space with the same matrix useMdl uploads
+static int LoadedModel_visible(struct LoadedModel* this, struct Frustum* frustum) {
+    struct Mat4 scratch;
+    struct Vec3 c = mat4_transformPoint(LoadedModel_matrix(this, &scratch), this->boundsCenter);
+    return frustum->testSphere(frustum, c.x, c.y, c.z, this->boundsRadius * LOADEDMODEL_SCALE);
+}
+// use + render, skipped entirely when the sphere is outside the frustum (NULL draws always)
+static void LoadedModel_draw(struct LoadedModel* this, struct Program* prog, struct Texture* texture, struct Frustum* frustum) {
+    if (frustum && !LoadedModel_visible(this, frustum))
+        return;
+    useMdl(this, prog);
+    render(&this->model, texture);
+}
+// hand the transform to a store; its update then builds the matrix with
+// every other tracked model's
+static void LoadedModel_track(struct LoadedModel* this, struct TransformStore* store) {
+    this->transforms = store;
+    this->transform = store->add(store, this->pos, this->rot,
+                                 Vec3.new(LOADEDMODEL_SCALE, LOADEDMODEL_SCALE, LOADEDMODEL_SCALE));
+}
+static void LoadedModel_moveTo(struct LoadedModel* this, struct Vec3 pos, struct Vec3 rot) {
+    this->pos = pos;
+    this->rot = rot;
+    if (this->transforms) {
+        this->transforms->setPosition(this->transforms, this->transform, pos);
+        this->transforms->setRotation(this->transforms, this->transform, rot);
+    }
+}
+// center of the vertex AABB, radius to the furthest vertex from it
+static void LoadedModel_computeBounds(struct LoadedModel* this, const struct ModelVertex* verts, int count) {
+    if (count == 0) {
+        this->boundsCenter = Vec3.new(0, 0, 0);
+        this->boundsRadius = 0;
+        return;
+    }
+    float mn[3] = { verts[0].position[0], verts[0].position[1], verts[0].position[2] };
+    float mx[3] = { mn[0], mn[1], mn[2] };
+    for (int i = 1; i < count; i++) {
+        const float* p = verts[i].position;
+        for (int k = 0; k < 3; k++) {
+            if (p[k] < mn[k]) mn[k] = p[k];
+            if (p[k] > mx[k]) mx[k] = p[k];
+        }
+    }
+    float cx = (mn[0]+mx[0])*0.5f, cy = (mn[1]+mx[1])*0.5f, cz = (mn[2]+mx[2])*0.5f;
+    float r2 = 0;
+    for (int i = 0; i < count; i++) {
+        const float* p = verts[i].position;
+        float dx = p[0]-cx, dy = p[1]-cy, dz = p[2]-cz;
+        float d2 = dx*dx + dy*dy + dz*dz;
+        if (d2 > r2) r2 = d2;
+    }
+    this->boundsCenter = Vec3.new(cx, cy, cz);
+    this->boundsRadius = sqrtf(r2);
 }
 static struct LoadedModel loadOBJ(const char* path, struct Vec3* pos, struct Vec3 *rot) {
     FILE* file = fopen(path, "r");
@@ -550,11 +629,9 @@ static struct LoadedModel loadOBJ(const char* path, struct Vec3* pos, struct Vec
     struct Vector normals  = Vector.new(0, FIELD_TYPE_VEC3);
     struct Vector uvs      = Vector.new(0, FIELD_TYPE_VEC2);
 
-    // Final expanded arrays
-    struct Vector finalVertices = Vector.new(0, FIELD_TYPE_VEC3);
-    struct Vector finalUVs      = Vector.new(0, FIELD_TYPE_VEC2);
+    // Final expanded arrays, position/uv/normal interleaved per vertex
+    struct Vector finalVertices = Vector.sized(0, sizeof(struct ModelVertex));
     struct Vector finalIndices  = Vector.new(0, FIELD_TYPE_INT);
-    struct Vector finalNormals  = Vector.new(0, FIELD_TYPE_VEC3);
     char line[512];
     int uvID = 1;
     while (fgets(line, sizeof(line), file)) {
@@ -590,9 +667,12 @@ static struct LoadedModel loadOBJ(const char* path, struct Vec3* pos, struct Vec
                     struct Vec3 nml = ((struct Vec3*)normals.data)[nIdx[i] - 1];
                     struct Vec2 uv  = ((struct Vec2*)uvs.data)[uvIdx[i] - 1];
                     //printf("nml ;; (%f, %f, %f)\n", nml.x, nml.y, nml.z);
-                    finalVertices.push_back(&finalVertices, &pos);
-                    finalUVs.push_back(&finalUVs, &uv);
-                    finalNormals.push_back(&finalNormals, &nml);
+                    struct ModelVertex vert = {
+                        .position = { pos.x, pos.y, pos.z },
+                        .uv = { uv.x, uv.y },
+                        .normal = { nml.x, nml.y, nml.z },
+                    };
+                    finalVertices.push_back(&finalVertices, &vert);
                     int newIndex = finalVertices.size - 1;
                     finalIndices.push_back(&finalIndices, &newIndex);
                 }
@@ -601,22 +681,23 @@ static struct LoadedModel loadOBJ(const char* path, struct Vec3* pos, struct Vec
     }
     fclose(file);
 
-    struct ModelDataInfo vInfo  = ModelDataInfo.new(finalVertices.data, ENG_VEC3, finalVertices.size);
-    struct ModelDataInfo uvInfo = ModelDataInfo.new(finalUVs.data,      ENG_VEC2,      finalUVs.size);
     struct ModelDataInfo iInfo  = ModelDataInfo.new(finalIndices.data,  ENG_INT,   finalIndices.size);
-    struct ModelDataInfo nInfo  = ModelDataInfo.new(finalNormals.data,  ENG_VEC3,  finalNormals.size);
     struct Model model = Model.new();
-    model.ld(&model, &vInfo, &iInfo, &uvInfo,&nInfo);
+    model.ldInterleaved(&model, finalVertices.data, finalVertices.size, &ModelVertex_layout, &iInfo);
+    struct LoadedModel loaded = { .model = model, .pos = *pos, .rot = *rot,
+                                  .transforms = NULL, .transform = -1,
+                                  .use = &useMdl, .visible = &LoadedModel_visible, .draw = &LoadedModel_draw,
+                                  .track = &LoadedModel_track, .moveTo = &LoadedModel_moveTo };
+    LoadedModel_computeBounds(&loaded, (struct ModelVertex*)finalVertices.data, finalVertices.size);
 
     // Cleanup
     vertices.destroy(&vertices);
     uvs.destroy(&uvs);
-    finalNormals.destroy(&finalNormals);
+    normals.destroy(&normals);
     finalVertices.destroy(&finalVertices);
-    finalUVs.destroy(&finalUVs);
     finalIndices.destroy(&finalIndices);
 
-    return (struct LoadedModel){ .model = model, .pos = *pos, .rot = *rot, .use = &useMdl};
+    return loaded;
 }
 
 static const struct {
@@ -1,97 +1,28 @@
 #ifndef MATRIX_H_
 #define MATRIX_H_
 
+#include "Vec.h"
 #include <stdio.h>
 #include <string.h>
 #include <math.h>
+// multiply, inverse and point transforms use SSE on x86;
+// define MATRIX_NO_SIMD to force the scalar versions
+#if !defined(MATRIX_NO_SIMD) && defined(__SSE2__)
+#define MATRIX_SSE 1
+#include <emmintrin.h>
+#endif
+// 16 floats and nothing else: row major, column vectors (m[row*4+col]).
+// The operations are the mat4_* functions below, which inline; the Mat4
+// table at the bottom carries the same functions for the Mat4.multiply(&m, ...)
+// style.
 struct Mat4 {
     float m[16];
-
-    // basics
-    void (*identity)(struct Mat4* this);
-    void (*copy)(struct Mat4* this, struct Mat4* src);
-    void (*print)(struct Mat4* this);
-
-    // element access
-    void (*set)(struct Mat4* this, int x, int y, float value);
-    float (*get)(struct Mat4* this, int x, int y);
-
-    // transforms
-    void (*translate)(struct Mat4* this, float x, float y, float z);
-    void (*scale)(struct Mat4* this, float sx, float sy, float sz);
-    void (*rotate)(struct Mat4* this, float x, float y, float z, float angle);
-    void (*multiply)(struct Mat4* this, struct Mat4* other);
-
-    // projections / views
-    void (*projection)(struct Mat4* this, float fov, float aspect, float near, float far);
-    void (*ortho)(struct Mat4* this, float left, float right, float bottom, float top, float near, float far);
-    void (*view)(struct Mat4* this, float x, float y, float z, float rx, float ry, float rz);
-    void (*view2D)(struct Mat4* this, float x, float y, float rz);
-    void (*transform)(struct Mat4* this, float x, float y, float z,
-                      float rx, float ry, float rz,
-                      float sx, float sy, float sz);
-    void (*transform2D)(struct Mat4* this, float x, float y, float rz, float sx, float sy);
-};
-static void mat4_identity(struct Mat4* this);
-static void mat4_copy(struct Mat4* this, struct Mat4* src);
-static void mat4_print(struct Mat4* this);
-
-static void mat4_set(struct Mat4* this, int x, int y, float value);
-static float mat4_get(struct Mat4* this, int x, int y);
-
-static void mat4_multiply(struct Mat4* this, struct Mat4* other);
-
-static void mat4_translate(struct Mat4* this, float x, float y, float z);
-
-static void mat4_scale(struct Mat4* this, float sx, float sy, float sz);
-
-static void mat4_rotate(struct Mat4* this, float x, float y, float z, float angle);
-// ---- projections / views ----
-static void mat4_projection(struct Mat4* this, float fov, float aspect, float near, float far);
-static void mat4_ortho(struct Mat4* this, float left, float right, float bottom, float top, float near, float far);
-static void mat4_view(struct Mat4* this, float x, float y, float z, float rx, float ry, float rz);
-
-static void mat4_view2D(struct Mat4* this, float x, float y, float rz);
-
-static void mat4_transform(struct Mat4* this, float x, float y, float z,
-                           float rx, float ry, float rz,
-                           float sx, float sy, float sz);
-
-static void mat4_transform2D(struct Mat4* this, float x, float y, float rz,
-                             float sx, float sy);
-
-static struct Mat4 newMat4() {
-    struct Mat4 m = {
-        .m = {0},
-        .identity = &mat4_identity,
-        .copy = &mat4_copy,
-        .print = &mat4_print,
-        .set = &mat4_set,
-        .get = &mat4_get,
-        .translate = &mat4_translate,
-        .scale = &mat4_scale,
-        .rotate = &mat4_rotate,
-        .multiply = &mat4_multiply,
-        .projection = &mat4_projection,
-        .ortho = &mat4_ortho,
-        .view = &mat4_view,
-        .view2D = &mat4_view2D,
-        .transform = &mat4_transform,
-        .transform2D = &mat4_transform2D
-    };
-    m.identity(&m);
-    return m;
-}
-
-static const struct {
-    struct Mat4 (*new)();
-} Mat4 = {
-    .new = &newMat4
 };
+_Static_assert(sizeof(struct Mat4) == 16 * sizeof(float), "Mat4 must stay 16 packed floats");
 
 // ---- helpers ----
-static void mat4_identity(struct Mat4* this) {
-    float id[16] = {
+static inline void mat4_identity(struct Mat4* this) {
+    static const float id[16] = {
         1,0,0,0,
         0,1,0,0,
         0,0,1,0,
@@ -100,7 +31,13 @@ static void mat4_identity(struct Mat4* this) {
     memcpy(this->m, id, sizeof(id));
 }
 
-static void mat4_copy(struct Mat4* this, struct Mat4* src) {
+static inline struct Mat4 mat4_new() {
+    struct Mat4 m;
+    mat4_identity(&m);
+    return m;
+}
+
+static inline void mat4_copy(struct Mat4* this, struct Mat4* src) {
     memcpy(this->m, src->m, sizeof(float)*16);
 }
 
@@ -113,119 +50,350 @@ static void mat4_print(struct Mat4* this) {
     printf("\n");
 }
 
-static void mat4_set(struct Mat4* this, int x, int y, float value) {
+static inline void mat4_set(struct Mat4* this, int x, int y, float value) {
     this->m[y*4+x] = value;
 }
-static float mat4_get(struct Mat4* this, int x, int y) {
+static inline float mat4_get(struct Mat4* this, int x, int y) {
     return this->m[y*4+x];
 }
 
-static void mat4_multiply(struct Mat4* this, struct Mat4* other) {
-    float temp[16] = {0};
+// out = a * b on raw row major arrays; out may be a or b.
+// Row i of the product is a[i][0]*b0 + a[i][1]*b1 + a[i][2]*b2 + a[i][3]*b3,
+// so each output row is four broadcasts against the rows of b
+static inline void mat4_multiplyf(float* out, const float* a, const float* b) {
+#ifdef MATRIX_SSE
+    __m128 b0 = _mm_loadu_ps(b + 0), b1 = _mm_loadu_ps(b + 4);
+    __m128 b2 = _mm_loadu_ps(b + 8), b3 = _mm_loadu_ps(b + 12);
+    __m128 r[4];
+    for (int i = 0; i < 4; i++) {
+        const float* ai = a + i*4;
+        r[i] = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(ai[0]), b0), _mm_mul_ps(_mm_set1_ps(ai[1]), b1)),
+                          _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ai[2]), b2), _mm_mul_ps(_mm_set1_ps(ai[3]), b3)));
+    }
+    for (int i = 0; i < 4; i++)
+        _mm_storeu_ps(out + i*4, r[i]);
+#else
+    float temp[16];
     for (int row = 0; row < 4; row++) {
         for (int col = 0; col < 4; col++) {
-            for (int k = 0; k < 4; k++) {
-                temp[row*4+col] += this->m[row*4+k] * other->m[k*4+col];
-            }
+            float sum = 0;
+            for (int k = 0; k < 4; k++)
+                sum += a[row*4+k] * b[k*4+col];
+            temp[row*4+col] = sum;
         }
     }
-    memcpy(this->m, temp, sizeof(temp));
+    memcpy(out, temp, sizeof(temp));
+#endif
 }
 
-static void mat4_translate(struct Mat4* this, float x, float y, float z) {
-    struct Mat4 t = Mat4.new();
-    t.set(&t, 3,0,x);
-    t.set(&t, 3,1,y);
-    t.set(&t, 3,2,z);
-    this->multiply(this, &t);
+// out = a * b
+static inline void mat4_mul(struct Mat4* out, const struct Mat4* a, const struct Mat4* b) {
+    mat4_multiplyf(out->m, a->m, b->m);
 }
 
-static void mat4_scale(struct Mat4* this, float sx, float sy, float sz) {
-    struct Mat4 s = Mat4.new();
-    s.set(&s, 0,0,sx);
-    s.set(&s, 1,1,sy);
-    s.set(&s, 2,2,sz);
-    this->multiply(this, &s);
+static inline void mat4_multiply(struct Mat4* this, struct Mat4* other) {
+    mat4_multiplyf(this->m, this->m, other->m);
 }
 
-static void mat4_rotate(struct Mat4* this, float x, float y, float z, float angle) {
+// m * (p, 1) without the divide, for model and view matrices
+static inline struct Vec3 mat4_transformPoint(const struct Mat4* this, struct Vec3 p) {
+    const float* m = this->m;
+    return newVec3(m[0]*p.x + m[1]*p.y + m[2]*p.z  + m[3],
+                   m[4]*p.x + m[5]*p.y + m[6]*p.z  + m[7],
+                   m[8]*p.x + m[9]*p.y + m[10]*p.z + m[11]);
+}
+
+// mat4_transformPoint over an array; out may be in
+static inline void mat4_transformPoints(const struct Mat4* this, const struct Vec3* in, struct Vec3* out, int count) {
+#ifdef MATRIX_SSE
+    // columns of m, so a point is c0*x + c1*y + c2*z + c3
+    const float* m = this->m;
+    __m128 c0 = _mm_setr_ps(m[0], m[4], m[8],  0);
+    __m128 c1 = _mm_setr_ps(m[1], m[5], m[9],  0);
+    __m128 c2 = _mm_setr_ps(m[2], m[6], m[10], 0);
+    __m128 c3 = _mm_setr_ps(m[3], m[7], m[11], 0);
+    for (int i = 0; i < count; i++) {
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(in[i].x)), _mm_mul_ps(c1, _mm_set1_ps(in[i].y))),
+                              _mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(in[i].z)), c3));
+        float v[4];
+        _mm_storeu_ps(v, r);
+        out[i] = newVec3(v[0], v[1], v[2]);
+    }
+#else
+    for (int i = 0; i < count; i++)
+        out[i] = mat4_transformPoint(this, in[i]);
+#endif
+}
+
+#ifdef MATRIX_SSE
+#define MATRIX_SHUFFLE(a, b, x, y, z, w) _mm_shuffle_ps(a, b, _MM_SHUFFLE(w, z, y, x))
+#define MATRIX_SWIZZLE(v, x, y, z, w) MATRIX_SHUFFLE(v, v, x, y, z, w)
+// products of 2x2 matrices packed (m00, m01, m10, m11) in one register:
+// A*B, adj(A)*B and A*adj(B)
+static inline __m128 Mat2_mul(__m128 a, __m128 b) {
+    return _mm_add_ps(_mm_mul_ps(a, MATRIX_SWIZZLE(b, 0,3,0,3)),
+                      _mm_mul_ps(MATRIX_SWIZZLE(a, 1,0,3,2), MATRIX_SWIZZLE(b, 2,1,2,1)));
+}
+static inline __m128 Mat2_adjMul(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(MATRIX_SWIZZLE(a, 3,3,0,0), b),
+                      _mm_mul_ps(MATRIX_SWIZZLE(a, 1,1,2,2), MATRIX_SWIZZLE(b, 2,3,0,1)));
+}
+static inline __m128 Mat2_mulAdj(__m128 a, __m128 b) {
+    return _mm_sub_ps(_mm_mul_ps(a, MATRIX_SWIZZLE(b, 3,0,3,0)),
+                      _mm_mul_ps(MATRIX_SWIZZLE(a, 1,0,3,2), MATRIX_SWIZZLE(b, 2,1,2,1)));
+}
+#endif
+
+// general inverse; returns 0 and leaves out alone when the matrix is singular.
+// out may be in
+static inline int mat4_inverse(struct Mat4* out, const struct Mat4* in) {
+#ifdef MATRIX_SSE
+    // block inverse over the four 2x2 corners A B / C D
+    __m128 r0 = _mm_loadu_ps(in->m + 0), r1 = _mm_loadu_ps(in->m + 4);
+    __m128 r2 = _mm_loadu_ps(in->m + 8), r3 = _mm_loadu_ps(in->m + 12);
+    __m128 A = _mm_movelh_ps(r0, r1), B = _mm_movehl_ps(r1, r0);
+    __m128 C = _mm_movelh_ps(r2, r3), D = _mm_movehl_ps(r3, r2);
+
+    // (|A| |B| |C| |D|)
+    __m128 detSub = _mm_sub_ps(_mm_mul_ps(MATRIX_SHUFFLE(r0, r2, 0,2,0,2), MATRIX_SHUFFLE(r1, r3, 1,3,1,3)),
+                               _mm_mul_ps(MATRIX_SHUFFLE(r0, r2, 1,3,1,3), MATRIX_SHUFFLE(r1, r3, 0,2,0,2)));
+    __m128 detA = MATRIX_SWIZZLE(detSub, 0,0,0,0), detB = MATRIX_SWIZZLE(detSub, 1,1,1,1);
+    __m128 detC = MATRIX_SWIZZLE(detSub, 2,2,2,2), detD = MATRIX_SWIZZLE(detSub, 3,3,3,3);
+
+    __m128 D_C = Mat2_adjMul(D, C);
+    __m128 A_B = Mat2_adjMul(A, B);
+    __m128 X = _mm_sub_ps(_mm_mul_ps(detD, A), Mat2_mul(B, D_C));
+    __m128 W = _mm_sub_ps(_mm_mul_ps(detA, D), Mat2_mul(C, A_B));
+    __m128 Y = _mm_sub_ps(_mm_mul_ps(detB, C), Mat2_mulAdj(D, A_B));
+    __m128 Z = _mm_sub_ps(_mm_mul_ps(detC, B), Mat2_mulAdj(A, D_C));
+
+    // |M| = |A||D| + |B||C| - tr(adj(A)B adj(D)C)
+    __m128 tr = _mm_mul_ps(A_B, MATRIX_SWIZZLE(D_C, 0,2,1,3));
+    tr = _mm_add_ps(tr, _mm_movehl_ps(tr, tr));
+    tr = _mm_add_ps(tr, MATRIX_SWIZZLE(tr, 1,1,1,1));
+    __m128 detM = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(detA, detD), _mm_mul_ps(detB, detC)),
+                             MATRIX_SWIZZLE(tr, 0,0,0,0));
+    float det = _mm_cvtss_f32(detM);
+    if (det == 0.0f || !isfinite(det))
+        return 0;
+
+    __m128 rDet = _mm_div_ps(_mm_setr_ps(1.f, -1.f, -1.f, 1.f), detM);
+    X = _mm_mul_ps(X, rDet);
+    Y = _mm_mul_ps(Y, rDet);
+    Z = _mm_mul_ps(Z, rDet);
+    W = _mm_mul_ps(W, rDet);
+    // the adjugate swizzle folded into the stores
+    _mm_storeu_ps(out->m + 0,  MATRIX_SHUFFLE(X, Y, 3,1,3,1));
+    _mm_storeu_ps(out->m + 4,  MATRIX_SHUFFLE(X, Y, 2,0,2,0));
+    _mm_storeu_ps(out->m + 8,  MATRIX_SHUFFLE(Z, W, 3,1,3,1));
+    _mm_storeu_ps(out->m + 12, MATRIX_SHUFFLE(Z, W, 2,0,2,0));
+    return 1;
+#else
+    // cofactor expansion
+    const float* m = in->m;
+    float inv[16];
+    inv[0]  =  m[5]*m[10]*m[15] - m[5]*m[11]*m[14] - m[9]*m[6]*m[15] + m[9]*m[7]*m[14] + m[13]*m[6]*m[11] - m[13]*m[7]*m[10];
+    inv[4]  = -m[4]*m[10]*m[15] + m[4]*m[11]*m[14] + m[8]*m[6]*m[15] - m[8]*m[7]*m[14] - m[12]*m[6]*m[11] + m[12]*m[7]*m[10];
+    inv[8]  =  m[4]*m[9]*m[15]  - m[4]*m[11]*m[13] - m[8]*m[5]*m[15] + m[8]*m[7]*m[13] + m[12]*m[5]*m[11] - m[12]*m[7]*m[9];
+    inv[12] = -m[4]*m[9]*m[14]  + m[4]*m[10]*m[13] + m[8]*m[5]*m[14] - m[8]*m[6]*m[13] - m[12]*m[5]*m[10] + m[12]*m[6]*m[9];
+    inv[1]  = -m[1]*m[10]*m[15] + m[1]*m[11]*m[14] + m[9]*m[2]*m[15] - m[9]*m[3]*m[14] - m[13]*m[2]*m[11] + m[13]*m[3]*m[10];
+    inv[5]  =  m[0]*m[10]*m[15] - m[0]*m[11]*m[14] - m[8]*m[2]*m[15] + m[8]*m[3]*m[14] + m[12]*m[2]*m[11] - m[12]*m[3]*m[10];
+    inv[9]  = -m[0]*m[9]*m[15]  + m[0]*m[11]*m[13] + m[8]*m[1]*m[15] - m[8]*m[3]*m[13] - m[12]*m[1]*m[11] + m[12]*m[3]*m[9];
+    inv[13] =  m[0]*m[9]*m[14]  - m[0]*m[10]*m[13] - m[8]*m[1]*m[14] + m[8]*m[2]*m[13] + m[12]*m[1]*m[10] - m[12]*m[2]*m[9];
+    inv[2]  =  m[1]*m[6]*m[15]  - m[1]*m[7]*m[14]  - m[5]*m[2]*m[15] + m[5]*m[3]*m[14] + m[13]*m[2]*m[7]  - m[13]*m[3]*m[6];
+    inv[6]  = -m[0]*m[6]*m[15]  + m[0]*m[7]*m[14]  + m[4]*m[2]*m[15] - m[4]*m[3]*m[14] - m[12]*m[2]*m[7]  + m[12]*m[3]*m[6];
+    inv[10] =  m[0]*m[5]*m[15]  - m[0]*m[7]*m[13]  - m[4]*m[1]*m[15] + m[4]*m[3]*m[13] + m[12]*m[1]*m[7]  - m[12]*m[3]*m[5];
+    inv[14] = -m[0]*m[5]*m[14]  + m[0]*m[6]*m[13]  + m[4]*m[1]*m[14] - m[4]*m[2]*m[13] - m[12]*m[1]*m[6]  + m[12]*m[2]*m[5];
+    inv[3]  = -m[1]*m[6]*m[11]  + m[1]*m[7]*m[10]  + m[5]*m[2]*m[11] - m[5]*m[3]*m[10] - m[9]*m[2]*m[7]   + m[9]*m[3]*m[6];
+    inv[7]  =  m[0]*m[6]*m[11]  - m[0]*m[7]*m[10]  - m[4]*m[2]*m[11] + m[4]*m[3]*m[10] + m[8]*m[2]*m[7]   - m[8]*m[3]*m[6];
+    inv[11] = -m[0]*m[5]*m[11]  + m[0]*m[7]*m[9]   + m[4]*m[1]*m[11] - m[4]*m[3]*m[9]  - m[8]*m[1]*m[7]   + m[8]*m[3]*m[5];
+    inv[15] =  m[0]*m[5]*m[10]  - m[0]*m[6]*m[9]   - m[4]*m[1]*m[10] + m[4]*m[2]*m[9]  + m[8]*m[1]*m[6]   - m[8]*m[2]*m[5];
+    float det = m[0]*inv[0] + m[1]*inv[4] + m[2]*inv[8] + m[3]*inv[12];
+    if (det == 0.0f || !isfinite(det))
+        return 0;
+    float r = 1.0f / det;
+    for (int i = 0; i < 16; i++)
+        out->m[i] = inv[i] * r;
+    return 1;
+#endif
+}
+
+// this = this * T(x, y, z): only the last column changes
+static inline void mat4_translate(struct Mat4* this, float x, float y, float z) {
+    float* m = this->m;
+    for (int row = 0; row < 4; row++)
+        m[row*4+3] += m[row*4+0]*x + m[row*4+1]*y + m[row*4+2]*z;
+}
+
+// this = this * S(sx, sy, sz): scales the first three columns
+static inline void mat4_scale(struct Mat4* this, float sx, float sy, float sz) {
+    float* m = this->m;
+    for (int row = 0; row < 4; row++) {
+        m[row*4+0] *= sx;
+        m[row*4+1] *= sy;
+        m[row*4+2] *= sz;
+    }
+}
+
+static inline void mat4_rotate(struct Mat4* this, float x, float y, float z, float angle) {
     float rad = angle * (float)M_PI / 180.0f;
     float co = cosf(rad);
     float si = sinf(rad);
     float C  = 1.0f - co;
 
-    struct Mat4 r = Mat4.new();
-    r.set(&r, 0,0, co + x*x*C);
-    r.set(&r, 0,1, x*y*C - z*si);
-    r.set(&r, 0,2, x*z*C + y*si);
+    struct Mat4 r = mat4_new();
+    mat4_set(&r, 0,0, co + x*x*C);
+    mat4_set(&r, 0,1, x*y*C - z*si);
+    mat4_set(&r, 0,2, x*z*C + y*si);
 
-    r.set(&r, 1,0, y*x*C + z*si);
-    r.set(&r, 1,1, co + y*y*C);
-    r.set(&r, 1,2, y*z*C - x*si);
+    mat4_set(&r, 1,0, y*x*C + z*si);
+    mat4_set(&r, 1,1, co + y*y*C);
+    mat4_set(&r, 1,2, y*z*C - x*si);
 
-    r.set(&r, 2,0, z*x*C - y*si);
-    r.set(&r, 2,1, z*y*C + x*si);
-    r.set(&r, 2,2, co + z*z*C);
+    mat4_set(&r, 2,0, z*x*C - y*si);
+    mat4_set(&r, 2,1, z*y*C + x*si);
+    mat4_set(&r, 2,2, co + z*z*C);
 
-    this->multiply(this, &r);
+    mat4_multiply(this, &r);
+}
+
+// the 3x3 rotate(1,0,0,rx) * rotate(0,1,0,ry) * rotate(0,0,1,rz) written out,
+// rows into r[0..8]
+static inline void mat4_eulerXYZ(float* r, float rx, float ry, float rz) {
+    const float k = (float)M_PI / 180.0f;
+    float cx = cosf(rx*k), sx = sinf(rx*k);
+    float cy = cosf(ry*k), sy = sinf(ry*k);
+    float cz = cosf(rz*k), sz = sinf(rz*k);
+    r[0] = cy*cz;               r[1] = cy*sz;               r[2] = -sy;
+    r[3] = sx*sy*cz - cx*sz;    r[4] = sx*sy*sz + cx*cz;    r[5] = sx*cy;
+    r[6] = cx*sy*cz + sx*sz;    r[7] = cx*sy*sz - sx*cz;    r[8] = cx*cy;
 }
 
 // ---- projections / views ----
-static void mat4_projection(struct Mat4* this, float fov, float aspect, float near, float far) {
-    this->identity(this);
+static inline void mat4_projection(struct Mat4* this, float fov, float aspect, float near, float far) {
+    mat4_identity(this);
     float t = tanf((fov * (float)M_PI / 180.0f) / 2.0f);
     float range = far - near;
-    this->set(this,0,0, 1.0f / (aspect * t));
-    this->set(this,1,1, 1.0f / t);
-    this->set(this,2,2, -(far + near) / range);
-    this->set(this,2,3, -1.0f);
-    this->set(this,3,2, -(2*far*near) / range);
-    this->set(this,3,3, 0.0f);
+    mat4_set(this,0,0, 1.0f / (aspect * t));
+    mat4_set(this,1,1, 1.0f / t);
+    mat4_set(this,2,2, -(far + near) / range);
+    mat4_set(this,2,3, -1.0f);
+    mat4_set(this,3,2, -(2*far*near) / range);
+    mat4_set(this,3,3, 0.0f);
 }
 
-static void mat4_ortho(struct Mat4* this, float left, float right, float bottom, float top, float near, float far) {
-    this->identity(this);
-    this->set(this,0,0, 2.0f / (right-left));
-    this->set(this,1,1, 2.0f / (top-bottom));
-    this->set(this,2,2, -2.0f / (far-near));
-    this->set(this,3,0, -(right+left)/(right-left));
-    this->set(this,3,1, -(top+bottom)/(top-bottom));
-    this->set(this,3,2, -(far+near)/(far-near));
+static inline void mat4_ortho(struct Mat4* this, float left, float right, float bottom, float top, float near, float far) {
+    mat4_identity(this);
+    mat4_set(this,0,0, 2.0f / (right-left));
+    mat4_set(this,1,1, 2.0f / (top-bottom));
+    mat4_set(this,2,2, -2.0f / (far-near));
+    mat4_set(this,3,0, -(right+left)/(right-left));
+    mat4_set(this,3,1, -(top+bottom)/(top-bottom));
+    mat4_set(this,3,2, -(far+near)/(far-near));
 }
 
-static void mat4_view(struct Mat4* this, float x, float y, float z, float rx, float ry, float rz) {
-    this->identity(this);
-    this->rotate(this, 1,0,0, rx);
-    this->rotate(this, 0,1,0, ry);
-    this->rotate(this, 0,0,1, rz);
-    this->translate(this, -x, -y, -z);
+// rotate x, y, z then translate by -position, written straight into the matrix
+static inline void mat4_view(struct Mat4* this, float x, float y, float z, float rx, float ry, float rz) {
+    float r[9];
+    mat4_eulerXYZ(r, rx, ry, rz);
+    float* m = this->m;
+    for (int row = 0; row < 3; row++) {
+        const float* rr = r + row*3;
+        m[row*4+0] = rr[0];
+        m[row*4+1] = rr[1];
+        m[row*4+2] = rr[2];
+        m[row*4+3] = -(rr[0]*x + rr[1]*y + rr[2]*z);
+    }
+    m[12] = 0; m[13] = 0; m[14] = 0; m[15] = 1;
 }
 
-static void mat4_view2D(struct Mat4* this, float x, float y, float rz) {
-    this->identity(this);
-    this->translate(this, -x, -y, 0);
-    this->rotate(this, 0,0,1, rz);
+static inline void mat4_view2D(struct Mat4* this, float x, float y, float rz) {
+    float r[9];
+    mat4_eulerXYZ(r, 0, 0, rz);
+    float* m = this->m;
+    m[0]  = r[0]; m[1]  = r[1]; m[2]  = 0; m[3]  = -x;
+    m[4]  = r[3]; m[5]  = r[4]; m[6]  = 0; m[7]  = -y;
+    m[8]  = 0;    m[9]  = 0;    m[10] = 1; m[11] = 0;
+    m[12] = 0;    m[13] = 0;    m[14] = 0; m[15] = 1;
 }
 
-static void mat4_transform(struct Mat4* this, float x, float y, float z,
-                           float rx, float ry, float rz,
-                           float sx, float sy, float sz) {
-    this->identity(this);
-    this->translate(this, x, y, z);
-    this->rotate(this, 1,0,0, rx);
-    this->rotate(this, 0,1,0, ry);
-    this->rotate(this, 0,0,1, rz);
-    this->scale(this, sx, sy, sz);
+// translate * rotate x * rotate y * rotate z * scale in one pass: the
+// rotation columns scaled, the translation in the last column
+static inline void mat4_transform(struct Mat4* this, float x, float y, float z,
+                                  float rx, float ry, float rz,
+                                  float sx, float sy, float sz) {
+    float r[9];
+    mat4_eulerXYZ(r, rx, ry, rz);
+    float* m = this->m;
+    m[0]  = r[0]*sx; m[1]  = r[1]*sy; m[2]  = r[2]*sz; m[3]  = x;
+    m[4]  = r[3]*sx; m[5]  = r[4]*sy; m[6]  = r[5]*sz; m[7]  = y;
+    m[8]  = r[6]*sx; m[9]  = r[7]*sy; m[10] = r[8]*sz; m[11] = z;
+    m[12] = 0;       m[13] = 0;       m[14] = 0;       m[15] = 1;
 }
 
-static void mat4_transform2D(struct Mat4* this, float x, float y, float rz,
-                             float sx, float sy) {
-    this->identity(this);
-    this->translate(this, x, y, 0);
-    this->rotate(this, 0,0,1, rz);
-    this->scale(this, sx, sy, 1);
+static inline void mat4_transform2D(struct Mat4* this, float x, float y, float rz,
+                                    float sx, float sy) {
+    mat4_transform(this, x, y, 0, 0, 0, rz, sx, sy, 1);
 }
 
 // ---- constructor ----
+static struct Mat4 newMat4() {
+    return mat4_new();
+}
+
+// the methods struct Mat4 used to carry, now taking the matrix explicitly
+static const struct {
+    struct Mat4 (*new)();
+
+    // basics
+    void (*identity)(struct Mat4* this);
+    void (*copy)(struct Mat4* this, struct Mat4* src);
+    void (*print)(struct Mat4* this);
+
+    // element access
+    void (*set)(struct Mat4* this, int x, int y, float value);
+    float (*get)(struct Mat4* this, int x, int y);
+
+    // transforms
+    void (*translate)(struct Mat4* this, float x, float y, float z);
+    void (*scale)(struct Mat4* this, float sx, float sy, float sz);
+    void (*rotate)(struct Mat4* this, float x, float y, float z, float angle);
+    void (*multiply)(struct Mat4* this, struct Mat4* other);
+    void (*mul)(struct Mat4* out, const struct Mat4* a, const struct Mat4* b);
+    int (*inverse)(struct Mat4* out, const struct Mat4* in);
+    struct Vec3 (*transformPoint)(const struct Mat4* this, struct Vec3 p);
+    void (*transformPoints)(const struct Mat4* this, const struct Vec3* in, struct Vec3* out, int count);
+
+    // projections / views
+    void (*projection)(struct Mat4* this, float fov, float aspect, float near, float far);
+    void (*ortho)(struct Mat4* this, float left, float right, float bottom, float top, float near, float far);
+    void (*view)(struct Mat4* this, float x, float y, float z, float rx, float ry, float rz);
+    void (*view2D)(struct Mat4* this, float x, float y, float rz);
+    void (*transform)(struct Mat4* this, float x, float y, float z,
+                      float rx, float ry, float rz,
+                      float sx, float sy, float sz);
+    void (*transform2D)(struct Mat4* this, float x, float y, float rz, float sx, float sy);
+} Mat4 = {
+    .new = &newMat4,
+    .identity = &mat4_identity,
+    .copy = &mat4_copy,
+    .print = &mat4_print,
+    .set = &mat4_set,
+    .get = &mat4_get,
+    .translate = &mat4_translate,
+    .scale = &mat4_scale,
+    .rotate = &mat4_rotate,
+    .multiply = &mat4_multiply,
+    .mul = &mat4_mul,
+    .inverse = &mat4_inverse,
+    .transformPoint = &mat4_transformPoint,
+    .transformPoints = &mat4_transformPoints,
+    .projection = &mat4_projection,
+    .ortho = &mat4_ortho,
+    .view = &mat4_view,
+    .view2D = &mat4_view2D,
+    .transform = &mat4_transform,
+    .transform2D = &mat4_transform2D
+};
 
 #endif
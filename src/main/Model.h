@@ -4,6 +4,8 @@
     #include "Vector.h"
     #include <stdio.h>
     #include <stdlib.h>
+    #include <stdint.h>
+    #include <stddef.h>
     #define GLFW_INCLUDE_NONE
     #include <GLFW/glfw3.h>
     #include <glad.h>
@@ -11,6 +13,7 @@
         ENG_INT = 1,
         ENG_VEC3 = 2,
         ENG_VEC2 = 3,
+        ENG_PACKED = 4, // one uint32 per vertex, decoded in the vertex shader
     } ModelDataType;
     static struct {
         struct Vector VAOS;
@@ -22,25 +25,51 @@
         int count;
     };
 
-    int store_attrib_data(int position, int coordinateSize, struct ModelDataInfo* info) {
+    // Every quad mesh (4 vertices per quad, {0,1,2,2,1,3} winding) draws from
+    // this one index buffer instead of building its own. It grows to the
+    // largest mesh requested so far; the buffer name never changes, so models
+    // created earlier keep working after a resize.
+    static struct {
+        GLuint iboID;
+        int quadCapacity;
+    } QuadIndexBuffer;
+
+    GLuint QuadIndexBuffer_reserve(int quadCount) {
+        if (QuadIndexBuffer.iboID == 0)
+            glGenBuffers(1, &QuadIndexBuffer.iboID);
+        if (quadCount <= QuadIndexBuffer.quadCapacity)
+            return QuadIndexBuffer.iboID;
+
+        int capacity = QuadIndexBuffer.quadCapacity ? QuadIndexBuffer.quadCapacity : 1024;
+        while (capacity < quadCount) capacity *= 2;
+
+        uint32_t* indices = (uint32_t*)malloc(capacity * 6 * sizeof(uint32_t));
+        const uint32_t inds[6] = {0, 1, 2, 2, 1, 3};
+        for (int q = 0; q < capacity; q++)
+            for (int k = 0; k < 6; k++)
+                indices[q * 6 + k] = (uint32_t)q * 4 + inds[k];
+
+        // the copy target is not VAO state, so whatever VAO is bound is left alone
+        glBindBuffer(GL_COPY_WRITE_BUFFER, QuadIndexBuffer.iboID);
+        glBufferData(GL_COPY_WRITE_BUFFER, capacity * 6 * sizeof(uint32_t), indices, GL_STATIC_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        free(indices);
+
+        QuadIndexBuffer.quadCapacity = capacity;
+        return QuadIndexBuffer.iboID;
+    }
+
+    GLuint store_attrib_data(int position, int coordinateSize, struct ModelDataInfo* info) {
         GLuint vboID;
         glGenBuffers(1, &vboID);
         ModelDataInitializer.VBOS.push_back(&ModelDataInitializer.VBOS, &vboID);
         switch(info->type) {
             case ENG_VEC3: {
-                float* dat = (float*)malloc((info->count*3)*sizeof(float));
-                struct Vec3* pdata = (struct Vec3*)(info->data);
-                for(int i = 0; i<info->count; i++) {
-                    //printf("vert: %f, %f, %f\n",pdata[i].getX(&pdata[i]), pdata[i].getY(&pdata[i]), pdata[i].getZ(&pdata[i]));
-                    dat[(i*3)+0] = pdata[i].getX(&pdata[i]);
-                    dat[(i*3)+1] = pdata[i].getY(&pdata[i]);
-                    dat[(i*3)+2] = pdata[i].getZ(&pdata[i]);
-                }
+                // Vec3 is three packed floats, so the array goes up as it is
                 glBindBuffer(GL_ARRAY_BUFFER, vboID);
-                glBufferData(GL_ARRAY_BUFFER, (info->count*3) * sizeof(float), dat, GL_STATIC_DRAW);
+                glBufferData(GL_ARRAY_BUFFER, info->count * sizeof(struct Vec3), info->data, GL_STATIC_DRAW);
                 glVertexAttribPointer(position, coordinateSize, GL_FLOAT, GL_FALSE, 0, 0);
                 glBindBuffer(GL_ARRAY_BUFFER, 0);
-                free(dat);
                 break;
             }
             case ENG_INT: {
@@ -54,28 +83,70 @@
                 break;
             }
             case ENG_VEC2: {
-                float* dat = (float*)malloc((info->count*2)*sizeof(float));
-                struct Vec2* pdata = (struct Vec2*)(info->data);
-                for(int i = 0; i<info->count; i++) {
-                   // printf("uv: %f, %f\n",pdata[i].getX(&pdata[i]), pdata[i].getY(&pdata[i]));
-                    dat[(i*2)+0] = pdata[i].getX(&pdata[i]);
-                    dat[(i*2)+1] = pdata[i].getY(&pdata[i]);
-                }
-                
                 glBindBuffer(GL_ARRAY_BUFFER, vboID);
-                glBufferData(GL_ARRAY_BUFFER, (info->count*2) * sizeof(float), dat, GL_STATIC_DRAW);
+                glBufferData(GL_ARRAY_BUFFER, info->count * sizeof(struct Vec2), info->data, GL_STATIC_DRAW);
                 glVertexAttribPointer(position, coordinateSize, GL_FLOAT, GL_FALSE, 0, 0);
                 glBindBuffer(GL_ARRAY_BUFFER, 0);
-                free(dat);
+                break;
+            }
+            case ENG_PACKED: {
+                glBindBuffer(GL_ARRAY_BUFFER, vboID);
+                glBufferData(GL_ARRAY_BUFFER, info->count * sizeof(uint32_t), info->data, GL_STATIC_DRAW);
+                glVertexAttribIPointer(position, coordinateSize, GL_UNSIGNED_INT, 0, 0);
+                glBindBuffer(GL_ARRAY_BUFFER, 0);
+                break;
             }
         }
         return vboID;
     }
+    // one attribute of an interleaved vertex: where it sits inside the
+    // vertex struct and how GL reads it. integer attributes keep their bits
+    // through glVertexAttribIPointer, like ENG_PACKED
+    struct VertexAttrib {
+        GLuint location;
+        GLint size;
+        GLenum type;
+        GLboolean normalized;
+        GLboolean integer;
+        size_t offset;
+    };
+    #define VERTEX_LAYOUT_MAX_ATTRIBS 8
+    struct VertexLayout {
+        GLsizei stride;
+        int attribCount;
+        struct VertexAttrib attribs[VERTEX_LAYOUT_MAX_ATTRIBS];
+    };
+    // float attribute read from member `field` of vertex struct `vertex`
+    #define VERTEX_ATTRIB(loc, count, vertex, field) \
+        { .location = (loc), .size = (count), .type = GL_FLOAT, .normalized = GL_FALSE, \
+          .integer = GL_FALSE, .offset = offsetof(vertex, field) }
+
+    // position/uv/normal in the same locations ld uses, one struct per vertex
+    struct ModelVertex {
+        float position[3];
+        float uv[2];
+        float normal[3];
+    };
+    static const struct VertexLayout ModelVertex_layout = {
+        .stride = sizeof(struct ModelVertex),
+        .attribCount = 3,
+        .attribs = {
+            VERTEX_ATTRIB(0, 3, struct ModelVertex, position),
+            VERTEX_ATTRIB(1, 2, struct ModelVertex, uv),
+            VERTEX_ATTRIB(2, 3, struct ModelVertex, normal),
+        },
+    };
+
     struct Model {
         int vaoID;
         GLuint iboID;
         int vertexCount;
 
+        // packed models only: their vertex buffer and its allocated size,
+        // so updatePacked can rewrite it in place
+        GLuint vboID;
+        int vboCapacity;
+
         void* vertices;
         void* normals;
         void* uvs;
@@ -83,6 +154,11 @@
         int indexCount;
 
         void(*ld)(struct Model* this, struct ModelDataInfo* v, struct ModelDataInfo* i,struct ModelDataInfo* uv,struct ModelDataInfo* n);
+        void(*ldPacked)(struct Model* this, struct ModelDataInfo* v, struct ModelDataInfo* i);
+        void(*ldInterleaved)(struct Model* this, const void* vertices, int vertexCount,
+                             const struct VertexLayout* layout, struct ModelDataInfo* i);
+        void(*updatePacked)(struct Model* this, struct ModelDataInfo* v);
+        void(*unloadPacked)(struct Model* this);
     };
     static void ldmd(struct Model* this, struct ModelDataInfo* v, struct ModelDataInfo* i, struct ModelDataInfo* uv,struct ModelDataInfo* n) {
         GLuint vaoID;
@@ -92,21 +168,133 @@
         GLuint uvData = store_attrib_data(1,2,uv);
         GLuint nData = store_attrib_data(2,3,n);
         ModelDataInitializer.VAOS.push_back(&ModelDataInitializer.VAOS, &vaoID);
-        GLuint iboID = store_attrib_data(0,0,i);
+        // no index data = quads drawn from the shared quad index buffer
+        GLuint iboID = i ? store_attrib_data(0,0,i) : QuadIndexBuffer_reserve(v->count / 4);
+        int indexCount = i ? i->count : (v->count / 4) * 6;
         this->vaoID = vaoID;
         this->iboID = iboID;
         //printf("%d\n", i->count);
-        this->vertexCount = i->count;
+        this->vertexCount = indexCount;
 
-        this->indexCount  = i->count;
+        this->indexCount  = indexCount;
 
     }
+    // packed vertices (ENG_PACKED) go to attribute 0 as a single uint, the
+    // VAO keeps that array enabled so only a bind is needed to draw.
+    // i may be NULL for quad meshes, see QuadIndexBuffer.
+    static void ldmdPacked(struct Model* this, struct ModelDataInfo* v, struct ModelDataInfo* i) {
+        GLuint vaoID;
+        glGenVertexArrays(1, &vaoID);
+        glBindVertexArray(vaoID);
+        GLuint vboID = store_attrib_data(0,1,v);
+        glEnableVertexAttribArray(0);
+        ModelDataInitializer.VAOS.push_back(&ModelDataInitializer.VAOS, &vaoID);
+        GLuint iboID = i ? store_attrib_data(0,0,i) : QuadIndexBuffer_reserve(v->count / 4);
+        int indexCount = i ? i->count : (v->count / 4) * 6;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID); // recorded in the VAO
+        glBindVertexArray(0);
+        this->vaoID = vaoID;
+        this->iboID = iboID;
+        this->vboID = vboID;
+        this->vboCapacity = v->count * sizeof(uint32_t);
+        this->vertexCount = indexCount;
+        this->indexCount  = indexCount;
+    }
+    // interleaved vertices go up as they are into one buffer, one
+    // glVertexAttribPointer per layout entry, all enabled in the VAO.
+    // i may be NULL for quad meshes, see QuadIndexBuffer.
+    static void ldmdInterleaved(struct Model* this, const void* vertices, int vertexCount,
+                                const struct VertexLayout* layout, struct ModelDataInfo* i) {
+        GLuint vaoID;
+        glGenVertexArrays(1, &vaoID);
+        glBindVertexArray(vaoID);
+        GLuint vboID;
+        glGenBuffers(1, &vboID);
+        ModelDataInitializer.VBOS.push_back(&ModelDataInitializer.VBOS, &vboID);
+        glBindBuffer(GL_ARRAY_BUFFER, vboID);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)vertexCount * layout->stride, vertices, GL_STATIC_DRAW);
+        for (int a = 0; a < layout->attribCount; a++) {
+            const struct VertexAttrib* attr = &layout->attribs[a];
+            if (attr->integer)
+                glVertexAttribIPointer(attr->location, attr->size, attr->type, layout->stride, (void*)attr->offset);
+            else
+                glVertexAttribPointer(attr->location, attr->size, attr->type, attr->normalized, layout->stride, (void*)attr->offset);
+            glEnableVertexAttribArray(attr->location);
+        }
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        ModelDataInitializer.VAOS.push_back(&ModelDataInitializer.VAOS, &vaoID);
+        GLuint iboID = i ? store_attrib_data(0,0,i) : QuadIndexBuffer_reserve(vertexCount / 4);
+        int indexCount = i ? i->count : (vertexCount / 4) * 6;
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, iboID); // recorded in the VAO
+        glBindVertexArray(0);
+        this->vaoID = vaoID;
+        this->iboID = iboID;
+        this->vboID = vboID;
+        this->vboCapacity = vertexCount * layout->stride;
+        this->vertexCount = indexCount;
+        this->indexCount  = indexCount;
+    }
+    // replace the vertices of a packed quad model without new GL objects.
+    // The buffer only grows (re-specified under the same name, which the
+    // VAO keeps pointing at); smaller meshes are a glBufferSubData.
+    static void updtPacked(struct Model* this, struct ModelDataInfo* v) {
+        if (this->vaoID == 0) {
+            ldmdPacked(this, v, NULL);
+            return;
+        }
+        int bytes = v->count * sizeof(uint32_t);
+        glBindBuffer(GL_ARRAY_BUFFER, this->vboID);
+        if (bytes > this->vboCapacity) {
+            int capacity = this->vboCapacity * 2;
+            if (capacity < bytes) capacity = bytes;
+            glBufferData(GL_ARRAY_BUFFER, capacity, NULL, GL_DYNAMIC_DRAW);
+            this->vboCapacity = capacity;
+        }
+        if (bytes > 0)
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, v->data);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        QuadIndexBuffer_reserve(v->count / 4);
+        this->vertexCount = (v->count / 4) * 6;
+        this->indexCount  = this->vertexCount;
+    }
+    // stop tracking a GL name so fr_exit does not delete it a second time
+    static void ModelDataInitializer_forget(struct Vector* names, GLuint id) {
+        GLuint* data = (GLuint*)names->data;
+        for (int i = names->size - 1; i >= 0; i--) {
+            if (data[i] != id) continue;
+            data[i] = data[names->size - 1];
+            names->size--;
+            return;
+        }
+    }
+    // free a packed model's VAO and vertex buffer now rather than at fr_exit;
+    // the shared quad index buffer stays
+    static void unldPacked(struct Model* this) {
+        if (this->vaoID) {
+            GLuint vaoID = this->vaoID;
+            glDeleteVertexArrays(1, &vaoID);
+            ModelDataInitializer_forget(&ModelDataInitializer.VAOS, vaoID);
+        }
+        if (this->vboID) {
+            glDeleteBuffers(1, &this->vboID);
+            ModelDataInitializer_forget(&ModelDataInitializer.VBOS, this->vboID);
+        }
+        this->vaoID = 0;
+        this->vboID = 0;
+        this->vboCapacity = 0;
+        this->vertexCount = 0;
+        this->indexCount = 0;
+    }
     inline static struct Model newModel() {
         return (struct Model) {
             .vaoID = 0,
             .iboID = 0,
             .vertexCount = 0,
             .ld = &ldmd,
+            .ldPacked = &ldmdPacked,
+            .ldInterleaved = &ldmdInterleaved,
+            .updatePacked = &updtPacked,
+            .unloadPacked = &unldPacked,
         };
     }
     static const struct {
@@ -132,10 +320,15 @@
     }
     void fr_exit() {
         for(int i = 0; i<ModelDataInitializer.VBOS.size; i++) {
-            glDeleteBuffers(1,&ModelDataInitializer.VBOS.data[i]);
+            glDeleteBuffers(1,&((GLuint*)ModelDataInitializer.VBOS.data)[i]);
         }
-        for(int i = 0; i<ModelDataInitializer.VBOS.size; i++) {
-            glDeleteVertexArrays(1, &ModelDataInitializer.VAOS.data[i]);
+        for(int i = 0; i<ModelDataInitializer.VAOS.size; i++) {
+            glDeleteVertexArrays(1, &((GLuint*)ModelDataInitializer.VAOS.data)[i]);
+        }
+        if (QuadIndexBuffer.iboID) {
+            glDeleteBuffers(1, &QuadIndexBuffer.iboID);
+            QuadIndexBuffer.iboID = 0;
+            QuadIndexBuffer.quadCapacity = 0;
         }
         ModelDataInitializer.VAOS.destroy(&ModelDataInitializer.VAOS);
         ModelDataInitializer.VBOS.destroy(&ModelDataInitializer.VBOS);
@@ -0,0 +1,439 @@
+#ifndef OCCLUSIONCULLER_H_
+#define OCCLUSIONCULLER_H_
+    #include "Matrix4.h"
+    #include "ThreadPool.h"
+    #include <stdlib.h>
+    #include <string.h>
+    #include <math.h>
+    #include <pthread.h>
+
+    // define OCCLUSION_NO_SIMD to force the scalar rasterizer
+    #if !defined(OCCLUSION_NO_SIMD) && defined(__SSE2__)
+    #include <emmintrin.h>
+    #define OCCLUSION_SSE2 1
+    #endif
+
+    // CPU occlusion culling. Occluders (boxes or closed meshes that are solid
+    // all the way through) are rasterized in software into a small depth
+    // buffer. That buffer is reduced into a hierarchy holding the nearest and
+    // farthest occluder depth of every tile. A bounding box is hidden when
+    // its nearest point lies behind the farthest occluder depth everywhere
+    // it covers on screen.
+    //
+    // Per frame, on the main thread:
+    //   addBox / addMesh   queue this frame's occluders
+    //   submit             rasterize them; with a pool the raster runs on a
+    //                      worker while the main thread streams the world and
+    //                      the GPU works through the previous frame
+    //   testAABB           waits for the raster once, then reads the hierarchy
+    // Nothing here touches GL, so it also runs headless.
+    #define OCCLUSION_DEFAULT_WIDTH 256
+    #define OCCLUSION_DEFAULT_HEIGHT 128
+    #define OCCLUSION_MAX_LEVELS 16
+    #define OCCLUSION_NEAR_W 1e-3f // clip w below this is treated as crossing the eye plane
+
+    struct OcclusionMesh {
+        const float* vertices;  // xyz triples; must stay valid until the raster is done
+        const int* indices;
+        int indexCount;
+        float model[16];        // row major, like Mat4
+    };
+
+    struct OcclusionList {
+        float* boxes;           // min xyz, max xyz per box
+        int boxCount, boxCapacity;
+        struct OcclusionMesh* meshes;
+        int meshCount, meshCapacity;
+    };
+
+    struct OcclusionState {
+        struct ThreadPool* pool;                // NULL = rasterize inside submit
+        int levels;
+        int levelWidth[OCCLUSION_MAX_LEVELS];
+        int levelHeight[OCCLUSION_MAX_LEVELS];
+        float* nearest[OCCLUSION_MAX_LEVELS];   // level 0 is the raster itself,
+        float* farthest[OCCLUSION_MAX_LEVELS];  // shared by both
+        float clip[16];                         // projection * view of the submitted frame
+        struct OcclusionList lists[2];
+        int filling;                            // list addBox/addMesh write to
+        int triangles;                          // rasterized by the last submit
+        pthread_mutex_t lock;
+        pthread_cond_t done;
+        int busy;
+    };
+
+    struct OcclusionCuller {
+        int width, height;  // depth buffer size in pixels, powers of two
+        struct OcclusionState* state;
+        void (*addBox)(struct OcclusionCuller* this, float minX, float minY, float minZ,
+                       float maxX, float maxY, float maxZ);
+        void (*addMesh)(struct OcclusionCuller* this, const float* vertices, const int* indices,
+                        int indexCount, struct Mat4* model);
+        void (*submit)(struct OcclusionCuller* this, struct Mat4* projection, struct Mat4* view);
+        void (*wait)(struct OcclusionCuller* this);
+        int (*testAABB)(struct OcclusionCuller* this, float minX, float minY, float minZ,
+                        float maxX, float maxY, float maxZ);
+        void (*destroy)(struct OcclusionCuller* this);
+    };
+
+    static inline void Occlusion_transform(const float* m, float x, float y, float z, float* out) {
+        for (int i = 0; i < 4; i++)
+            out[i] = m[i*4+0]*x + m[i*4+1]*y + m[i*4+2]*z + m[i*4+3];
+    }
+
+    static inline void Occlusion_multiply(const float* a, const float* b, float* out) {
+        mat4_multiplyf(out, a, b);
+    }
+
+    // clip space -> pixel x, pixel y, depth in [0,1]
+    static inline void Occlusion_toScreen(const struct OcclusionState* s, const float* c, float* out) {
+        float iw = 1.0f / c[3];
+        out[0] = (c[0] * iw * 0.5f + 0.5f) * s->levelWidth[0];
+        out[1] = (c[1] * iw * 0.5f + 0.5f) * s->levelHeight[0];
+        out[2] = c[2] * iw * 0.5f + 0.5f;
+    }
+
+    // Edge-function rasterizer, keeping the nearest depth per pixel center.
+    // Triangles reaching behind the eye are dropped rather than clipped:
+    // losing an occluder only ever makes the test more conservative.
+    static void Occlusion_rasterTriangle(struct OcclusionState* s, const float* ca, const float* cb, const float* cc) {
+        if (ca[3] < OCCLUSION_NEAR_W || cb[3] < OCCLUSION_NEAR_W || cc[3] < OCCLUSION_NEAR_W)
+            return;
+        float a[3], b[3], c[3];
+        Occlusion_toScreen(s, ca, a);
+        Occlusion_toScreen(s, cb, b);
+        Occlusion_toScreen(s, cc, c);
+        float area = (b[0]-a[0])*(c[1]-a[1]) - (b[1]-a[1])*(c[0]-a[0]);
+        if (fabsf(area) < 1e-8f)
+            return;
+        if (area < 0) { // both windings count, flip to counter clockwise
+            float t[3]; memcpy(t, b, sizeof(t)); memcpy(b, c, sizeof(t)); memcpy(c, t, sizeof(t));
+            area = -area;
+        }
+
+        int width = s->levelWidth[0], height = s->levelHeight[0];
+        int minX = (int)floorf(fminf(a[0], fminf(b[0], c[0])));
+        int maxX = (int)ceilf(fmaxf(a[0], fmaxf(b[0], c[0])));
+        int minY = (int)floorf(fminf(a[1], fminf(b[1], c[1])));
+        int maxY = (int)ceilf(fmaxf(a[1], fmaxf(b[1], c[1])));
+        if (minX < 0) minX = 0;
+        if (minY < 0) minY = 0;
+        if (maxX > width - 1) maxX = width - 1;
+        if (maxY > height - 1) maxY = height - 1;
+        if (minX > maxX || minY > maxY)
+            return;
+
+        // E(p) = A*x + B*y + C is >= 0 on the inner side of each edge
+        const float* v[3] = {a, b, c};
+        float A[3], B[3], C[3];
+        for (int e = 0; e < 3; e++) {
+            const float* p0 = v[e];
+            const float* p1 = v[(e + 1) % 3];
+            A[e] = p0[1] - p1[1];
+            B[e] = p1[0] - p0[0];
+            C[e] = -(A[e] * p0[0] + B[e] * p0[1]);
+        }
+        // depth is linear in screen space: weights are the opposite edges over the area
+        float inv = 1.0f / area;
+        float zx = (A[1]*a[2] + A[2]*b[2] + A[0]*c[2]) * inv;
+        float zy = (B[1]*a[2] + B[2]*b[2] + B[0]*c[2]) * inv;
+        float z0 = (C[1]*a[2] + C[2]*b[2] + C[0]*c[2]) * inv;
+
+        float* depth = s->nearest[0];
+        minX &= ~3; // whole 4-pixel groups, width is a multiple of 4
+#ifdef OCCLUSION_SSE2
+        __m128 offsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+        __m128 zero = _mm_setzero_ps();
+        __m128 a0 = _mm_set1_ps(A[0]), a1 = _mm_set1_ps(A[1]), a2 = _mm_set1_ps(A[2]);
+        __m128 zX = _mm_set1_ps(zx);
+        for (int y = minY; y <= maxY; y++) {
+            float fy = y + 0.5f;
+            __m128 r0 = _mm_set1_ps(B[0]*fy + C[0]);
+            __m128 r1 = _mm_set1_ps(B[1]*fy + C[1]);
+            __m128 r2 = _mm_set1_ps(B[2]*fy + C[2]);
+            __m128 rz = _mm_set1_ps(zy*fy + z0);
+            float* row = depth + y * width;
+            for (int x = minX; x <= maxX; x += 4) {
+                __m128 fx = _mm_add_ps(_mm_set1_ps((float)x), offsets);
+                __m128 e0 = _mm_add_ps(_mm_mul_ps(a0, fx), r0);
+                __m128 e1 = _mm_add_ps(_mm_mul_ps(a1, fx), r1);
+                __m128 e2 = _mm_add_ps(_mm_mul_ps(a2, fx), r2);
+                __m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)),
+                                           _mm_cmpge_ps(e2, zero));
+                if (_mm_movemask_ps(inside) == 0)
+                    continue;
+                __m128 old = _mm_loadu_ps(row + x);
+                __m128 z = _mm_min_ps(old, _mm_add_ps(_mm_mul_ps(zX, fx), rz));
+                _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, z), _mm_andnot_ps(inside, old)));
+            }
+        }
+#else
+        for (int y = minY; y <= maxY; y++) {
+            float fy = y + 0.5f;
+            float r0 = B[0]*fy + C[0], r1 = B[1]*fy + C[1], r2 = B[2]*fy + C[2];
+            float rz = zy*fy + z0;
+            float* row = depth + y * width;
+            for (int x = minX; x <= maxX; x++) {
+                float fx = x + 0.5f;
+                if (A[0]*fx + r0 < 0 || A[1]*fx + r1 < 0 || A[2]*fx + r2 < 0)
+                    continue;
+                float z = zx*fx + rz;
+                if (z < row[x]) row[x] = z;
+            }
+        }
+#endif
+        s->triangles++;
+    }
+
+    static const int OCCLUSION_BOX_TRIANGLES[12][3] = {
+        {0,1,3}, {0,3,2}, {4,6,7}, {4,7,5}, // -x, +x
+        {0,4,5}, {0,5,1}, {2,3,7}, {2,7,6}, // -y, +y
+        {0,2,6}, {0,6,4}, {1,5,7}, {1,7,3}, // -z, +z
+    };
+
+    static void Occlusion_rasterBox(struct OcclusionState* s, const float* box) {
+        float corners[8][4];
+        for (int i = 0; i < 8; i++)
+            Occlusion_transform(s->clip, box[(i & 4) ? 3 : 0], box[(i & 2) ? 4 : 1], box[(i & 1) ? 5 : 2], corners[i]);
+        for (int t = 0; t < 12; t++)
+            Occlusion_rasterTriangle(s, corners[OCCLUSION_BOX_TRIANGLES[t][0]],
+                                        corners[OCCLUSION_BOX_TRIANGLES[t][1]],
+                                        corners[OCCLUSION_BOX_TRIANGLES[t][2]]);
+    }
+
+    static void Occlusion_rasterMesh(struct OcclusionState* s, const struct OcclusionMesh* mesh) {
+        float mvp[16];
+        Occlusion_multiply(s->clip, mesh->model, mvp);
+        for (int i = 0; i + 2 < mesh->indexCount; i += 3) {
+            float c[3][4];
+            for (int k = 0; k < 3; k++) {
+                const float* p = mesh->vertices + mesh->indices[i + k] * 3;
+                Occlusion_transform(mvp, p[0], p[1], p[2], c[k]);
+            }
+            Occlusion_rasterTriangle(s, c[0], c[1], c[2]);
+        }
+    }
+
+    // each level keeps the nearest and farthest depth of the 2x2 block below it
+    static void Occlusion_buildHierarchy(struct OcclusionState* s) {
+        for (int l = 1; l < s->levels; l++) {
+            int pw = s->levelWidth[l - 1], ph = s->levelHeight[l - 1];
+            int w = s->levelWidth[l], h = s->levelHeight[l];
+            const float* pn = s->nearest[l - 1];
+            const float* pf = s->farthest[l - 1];
+            for (int y = 0; y < h; y++) {
+                int y0 = y * 2, y1 = (y * 2 + 1 < ph) ? y * 2 + 1 : y0;
+                for (int x = 0; x < w; x++) {
+                    int x0 = x * 2, x1 = (x * 2 + 1 < pw) ? x * 2 + 1 : x0;
+                    float n = fminf(fminf(pn[y0*pw+x0], pn[y0*pw+x1]), fminf(pn[y1*pw+x0], pn[y1*pw+x1]));
+                    float f = fmaxf(fmaxf(pf[y0*pw+x0], pf[y0*pw+x1]), fmaxf(pf[y1*pw+x0], pf[y1*pw+x1]));
+                    s->nearest[l][y*w+x] = n;
+                    s->farthest[l][y*w+x] = f;
+                }
+            }
+        }
+    }
+
+    static void Occlusion_raster(struct OcclusionState* s, struct OcclusionList* list) {
+        int count = s->levelWidth[0] * s->levelHeight[0];
+        for (int i = 0; i < count; i++)
+            s->nearest[0][i] = 1.0f; // far plane
+        s->triangles = 0;
+        for (int i = 0; i < list->boxCount; i++)
+            Occlusion_rasterBox(s, list->boxes + i * 6);
+        for (int i = 0; i < list->meshCount; i++)
+            Occlusion_rasterMesh(s, &list->meshes[i]);
+        Occlusion_buildHierarchy(s);
+    }
+
+    static void OcclusionCuller_job(void* arg) {
+        struct OcclusionState* s = (struct OcclusionState*)arg;
+        Occlusion_raster(s, &s->lists[s->filling ^ 1]);
+        pthread_mutex_lock(&s->lock);
+        s->busy = 0;
+        pthread_cond_broadcast(&s->done);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    static void OcclusionCuller_wait(struct OcclusionCuller* this) {
+        struct OcclusionState* s = this->state;
+        pthread_mutex_lock(&s->lock);
+        while (s->busy)
+            pthread_cond_wait(&s->done, &s->lock);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    static void OcclusionCuller_addBox(struct OcclusionCuller* this, float minX, float minY, float minZ,
+                                       float maxX, float maxY, float maxZ) {
+        struct OcclusionList* list = &this->state->lists[this->state->filling];
+        if (list->boxCount == list->boxCapacity) {
+            list->boxCapacity = list->boxCapacity ? list->boxCapacity * 2 : 64;
+            list->boxes = (float*)realloc(list->boxes, list->boxCapacity * 6 * sizeof(float));
+        }
+        float* box = list->boxes + list->boxCount++ * 6;
+        box[0] = minX; box[1] = minY; box[2] = minZ;
+        box[3] = maxX; box[4] = maxY; box[5] = maxZ;
+    }
+
+    // model may be NULL for vertices already in world space
+    static void OcclusionCuller_addMesh(struct OcclusionCuller* this, const float* vertices, const int* indices,
+                                        int indexCount, struct Mat4* model) {
+        struct OcclusionList* list = &this->state->lists[this->state->filling];
+        if (list->meshCount == list->meshCapacity) {
+            list->meshCapacity = list->meshCapacity ? list->meshCapacity * 2 : 8;
+            list->meshes = (struct OcclusionMesh*)realloc(list->meshes, list->meshCapacity * sizeof(struct OcclusionMesh));
+        }
+        struct OcclusionMesh* mesh = &list->meshes[list->meshCount++];
+        mesh->vertices = vertices;
+        mesh->indices = indices;
+        mesh->indexCount = indexCount;
+        if (model) {
+            memcpy(mesh->model, model->m, sizeof(mesh->model));
+        } else {
+            struct Mat4 id = Mat4.new();
+            memcpy(mesh->model, id.m, sizeof(mesh->model));
+        }
+    }
+
+    // rasterizes everything added since the last submit
+    static void OcclusionCuller_submit(struct OcclusionCuller* this, struct Mat4* projection, struct Mat4* view) {
+        struct OcclusionState* s = this->state;
+        OcclusionCuller_wait(this);
+        Occlusion_multiply(projection->m, view->m, s->clip);
+        s->filling ^= 1;
+        s->lists[s->filling].boxCount = 0;
+        s->lists[s->filling].meshCount = 0;
+        if (!s->pool) {
+            Occlusion_raster(s, &s->lists[s->filling ^ 1]);
+            return;
+        }
+        pthread_mutex_lock(&s->lock);
+        s->busy = 1;
+        pthread_mutex_unlock(&s->lock);
+        s->pool->submit(s->pool, &OcclusionCuller_job, s);
+    }
+
+    // is the box's nearest depth behind the farthest occluder in every covered texel?
+    // coarse texels settle most boxes; only texels where the box falls between
+    // the nearest and farthest occluder depth are split into their children
+    static int Occlusion_hidden(const struct OcclusionState* s, int level, int x0, int y0, int x1, int y1, float z) {
+        int w = s->levelWidth[level];
+        for (int y = y0 >> level; y <= y1 >> level; y++) {
+            for (int x = x0 >> level; x <= x1 >> level; x++) {
+                if (z > s->farthest[level][y*w+x])
+                    continue;
+                if (level == 0 || z <= s->nearest[level][y*w+x])
+                    return 0;
+                int cx0 = x << level, cy0 = y << level;
+                int cx1 = cx0 + (1 << level) - 1, cy1 = cy0 + (1 << level) - 1;
+                if (!Occlusion_hidden(s, level - 1, cx0 > x0 ? cx0 : x0, cy0 > y0 ? cy0 : y0,
+                                      cx1 < x1 ? cx1 : x1, cy1 < y1 ? cy1 : y1, z))
+                    return 0;
+            }
+        }
+        return 1;
+    }
+
+    // 1 = may be visible, 0 = hidden behind this frame's occluders
+    static int OcclusionCuller_testAABB(struct OcclusionCuller* this, float minX, float minY, float minZ,
+                                        float maxX, float maxY, float maxZ) {
+        OcclusionCuller_wait(this);
+        const struct OcclusionState* s = this->state;
+        float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY, zNear = INFINITY;
+        for (int i = 0; i < 8; i++) {
+            float c[4], p[3];
+            Occlusion_transform(s->clip, (i & 4) ? maxX : minX, (i & 2) ? maxY : minY, (i & 1) ? maxZ : minZ, c);
+            if (c[3] < OCCLUSION_NEAR_W)
+                return 1; // reaches behind the eye
+            Occlusion_toScreen(s, c, p);
+            x0 = fminf(x0, p[0]); x1 = fmaxf(x1, p[0]);
+            y0 = fminf(y0, p[1]); y1 = fmaxf(y1, p[1]);
+            zNear = fminf(zNear, p[2]);
+        }
+        if (zNear <= 0.0f)
+            return 1; // in front of the near plane
+        int px0 = x0 < 0 ? 0 : (int)floorf(x0);
+        int py0 = y0 < 0 ? 0 : (int)floorf(y0);
+        int px1 = x1 > this->width ? this->width - 1 : (int)ceilf(x1) - 1;
+        int py1 = y1 > this->height ? this->height - 1 : (int)ceilf(y1) - 1;
+        if (px1 < px0) px1 = px0;
+        if (py1 < py0) py1 = py0;
+        if (px0 >= this->width || py0 >= this->height || x1 < 0 || y1 < 0)
+            return 1; // off screen is for the frustum to decide
+
+        // start where the box spans at most two texels a side
+        int span = (px1 - px0 > py1 - py0) ? px1 - px0 : py1 - py0;
+        int level = 0;
+        while (level < s->levels - 1 && (span >> level) > 1)
+            level++;
+        return !Occlusion_hidden(s, level, px0, py0, px1, py1, zNear);
+    }
+
+    static void OcclusionCuller_destroy(struct OcclusionCuller* this) {
+        struct OcclusionState* s = this->state;
+        if (!s) return;
+        OcclusionCuller_wait(this);
+        for (int l = 0; l < s->levels; l++) {
+            free(s->nearest[l]);
+            if (l > 0) free(s->farthest[l]);
+        }
+        for (int i = 0; i < 2; i++) {
+            free(s->lists[i].boxes);
+            free(s->lists[i].meshes);
+        }
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->done);
+        free(s);
+        this->state = NULL;
+    }
+
+    static int Occlusion_powerOfTwo(int n, int floor) {
+        int p = floor;
+        while (p < n) p <<= 1;
+        return p;
+    }
+
+    // width/height are rounded up to powers of two (at least 4 wide); 0 picks the default.
+    // pool NULL rasterizes synchronously inside submit; the pool is borrowed, not owned
+    static struct OcclusionCuller newOcclusionCuller(int width, int height, struct ThreadPool* pool) {
+        width = Occlusion_powerOfTwo(width > 0 ? width : OCCLUSION_DEFAULT_WIDTH, 4);
+        height = Occlusion_powerOfTwo(height > 0 ? height : OCCLUSION_DEFAULT_HEIGHT, 1);
+        struct OcclusionState* s = (struct OcclusionState*)calloc(1, sizeof(struct OcclusionState));
+        s->pool = pool;
+        int w = width, h = height;
+        for (;;) {
+            int l = s->levels++;
+            s->levelWidth[l] = w;
+            s->levelHeight[l] = h;
+            s->nearest[l] = (float*)malloc(w * h * sizeof(float));
+            s->farthest[l] = l == 0 ? s->nearest[0] : (float*)malloc(w * h * sizeof(float));
+            if ((w == 1 && h == 1) || s->levels == OCCLUSION_MAX_LEVELS)
+                break;
+            w = w > 1 ? w / 2 : 1;
+            h = h > 1 ? h / 2 : 1;
+        }
+        for (int i = 0; i < width * height; i++)
+            s->nearest[0][i] = 1.0f;
+        Occlusion_buildHierarchy(s);
+        struct Mat4 id = Mat4.new();
+        memcpy(s->clip, id.m, sizeof(s->clip));
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_cond_init(&s->done, NULL);
+        return (struct OcclusionCuller) {
+            .width = width,
+            .height = height,
+            .state = s,
+            .addBox = &OcclusionCuller_addBox,
+            .addMesh = &OcclusionCuller_addMesh,
+            .submit = &OcclusionCuller_submit,
+            .wait = &OcclusionCuller_wait,
+            .testAABB = &OcclusionCuller_testAABB,
+            .destroy = &OcclusionCuller_destroy,
+        };
+    }
+
+    static const struct {
+        struct OcclusionCuller (*new)(int width, int height, struct ThreadPool* pool);
+    } OcclusionCuller = { .new = &newOcclusionCuller };
+
+#endif
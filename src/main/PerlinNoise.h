@@ -2,9 +2,26 @@
 #define PERLINNOISE_H_
 
 #include "Vec.h"
-#include "Vector.h"
 #include <math.h>
+#include <stdint.h>
 #include <stdlib.h>
+
+// x86 builds get SSE2/AVX2 batch kernels picked at runtime; define
+// PERLIN_NO_SIMD to force the scalar path everywhere
+#if (defined(__x86_64__) || defined(__i386__)) && !defined(PERLIN_NO_SIMD)
+#define PERLIN_X86 1
+#include <immintrin.h>
+#endif
+
+// Every noise path has to round the same way, so nothing in this header may
+// be contracted into FMA, whatever -ffp-contract or -march the includer uses
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
 static inline float fade(float t) {
     return t * t * t * (t * (t * 6 - 15) + 10);
 }
@@ -13,72 +30,443 @@ static inline float lerp(float a, float b, float t) {
     return a + t * (b - a);
 }
 
-static inline float gradDot(struct Vec2 g, float x, float y) {
-    return g.x * x + g.y * y;
+// splitmix64; the state is the caller's, so seeding never touches rand()
+static inline uint64_t Perlin_nextRandom(uint64_t* state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
 }
 
+// Octave settings for the fractal sums: each octave scales frequency by
+// lacunarity and amplitude by gain. Ridged sums (1 - |n|)^2 instead of n,
+// which gives sharp crests. Results are normalized back to -1..1.
+struct PerlinFractal {
+    int octaves;
+    float lacunarity;
+    float gain;
+    int ridged;
+};
+
+// The gradient table tiles every `dimension` lattice cells. dimension is
+// rounded up to a power of two so lattice coordinates wrap with a mask.
+// Gradients are kept as two float arrays (x and y) indexed x + y * dimension,
+// which is what the SIMD kernels gather from. 3D noise hashes lattice points
+// through a permutation of 0..dimension-1 into 16 edge gradients.
+// Nothing is written after construction, so one instance can be sampled
+// from any number of threads.
 struct PerlinNoise {
     int dimension;
-    struct Vector vectors;
+    int shift; // log2(dimension)
+    int mask;  // dimension - 1
+    float* gradX;
+    float* gradY;
+    int* perm;
     float (*noiseAt)(struct PerlinNoise* this, struct Vec2 position);
+    float (*noise3At)(struct PerlinNoise* this, float x, float y, float z);
+    float (*fractalAt)(struct PerlinNoise* this, struct Vec2 position, struct PerlinFractal fractal);
+    // out[i + j * width] = noise at (x0 + i * step, y0 + j * step)
+    void (*fillGrid)(struct PerlinNoise* this, float* out, int width, int height, float x0, float y0, float step);
+    void (*fillGridFractal)(struct PerlinNoise* this, float* out, int width, int height, float x0, float y0, float step, struct PerlinFractal fractal);
+    // out[x + y * sx + z * sx * sy] = 3D fractal noise at
+    // (x0 + x * step, y0 + y * stepY, z0 + z * step); for power of two sizes
+    // this is the CHUNK_INDEX layout
+    void (*fillVolume)(struct PerlinNoise* this, float* out, int sx, int sy, int sz, float x0, float y0, float z0, float step, float stepY, struct PerlinFractal fractal);
     void (*destroy)(struct PerlinNoise* this);
 };
 
-static float perlinNoiseAt(struct PerlinNoise* this, struct Vec2 position) {
-    int dim = this->dimension;
-
-    int xi = (int)floorf(position.x) % dim;
-    int yi = (int)floorf(position.y) % dim;
-    if (xi < 0) xi += dim;
-    if (yi < 0) yi += dim;
-
-    float xf = position.x - floorf(position.x);
-    float yf = position.y - floorf(position.y);
+static inline float Perlin_sample(const struct PerlinNoise* this, float x, float y) {
+    float fx = floorf(x);
+    float fy = floorf(y);
+    int xi = (int)fx & this->mask;
+    int yi = (int)fy & this->mask;
+    int xi1 = (xi + 1) & this->mask;
+    int r0 = yi << this->shift;
+    int r1 = ((yi + 1) & this->mask) << this->shift;
 
+    float xf = x - fx;
+    float yf = y - fy;
     float u = fade(xf);
     float v = fade(yf);
 
-    struct Vec2 g00 = ((struct Vec2*)this->vectors.data)[xi + yi * dim];
-    struct Vec2 g10 = ((struct Vec2*)this->vectors.data)[(xi + 1) % dim + yi * dim];
-    struct Vec2 g01 = ((struct Vec2*)this->vectors.data)[xi + ((yi + 1) % dim) * dim];
-    struct Vec2 g11 = ((struct Vec2*)this->vectors.data)[(xi + 1) % dim + ((yi + 1) % dim) * dim];
-
-    float n00 = gradDot(g00, xf, yf);
-    float n10 = gradDot(g10, xf - 1, yf);
-    float n01 = gradDot(g01, xf, yf - 1);
-    float n11 = gradDot(g11, xf - 1, yf - 1);
+    const float* gx = this->gradX;
+    const float* gy = this->gradY;
+    float n00 = gx[r0 + xi]  * xf       + gy[r0 + xi]  * yf;
+    float n10 = gx[r0 + xi1] * (xf - 1) + gy[r0 + xi1] * yf;
+    float n01 = gx[r1 + xi]  * xf       + gy[r1 + xi]  * (yf - 1);
+    float n11 = gx[r1 + xi1] * (xf - 1) + gy[r1 + xi1] * (yf - 1);
 
     float x1 = lerp(n00, n10, u);
     float x2 = lerp(n01, n11, u);
     return lerp(x1, x2, v);
 }
 
+static float perlinNoiseAt(struct PerlinNoise* this, struct Vec2 position) {
+    return Perlin_sample(this, position.x, position.y);
+}
+
+static void Perlin_fillGridScalar(struct PerlinNoise* this, float* out, int width, int height, float x0, float y0, float step) {
+    for (int j = 0; j < height; j++) {
+        float y = y0 + (float)j * step;
+        for (int i = 0; i < width; i++)
+            out[i + j * width] = Perlin_sample(this, x0 + (float)i * step, y);
+    }
+}
+
+#ifdef PERLIN_X86
+// The kernels vectorize along x; everything that depends on y is set up
+// once per row. They do the same float operations in the same order as
+// Perlin_sample, and contraction is off above, so every path returns
+// identical values and a seed produces the same world on any CPU.
+
+__attribute__((target("sse2")))
+static void Perlin_fillGridSSE2(struct PerlinNoise* this, float* out, int width, int height, float x0, float y0, float step) {
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 c6 = _mm_set1_ps(6.0f), c15 = _mm_set1_ps(15.0f), c10 = _mm_set1_ps(10.0f);
+    const __m128i mask = _mm_set1_epi32(this->mask);
+    const __m128 vx0 = _mm_set1_ps(x0), vstep = _mm_set1_ps(step);
+    int xi[4], xi1[4];
+    float g[8][4];
+
+    for (int j = 0; j < height; j++) {
+        float y = y0 + (float)j * step;
+        float fy = floorf(y);
+        int yi = (int)fy & this->mask;
+        const float* gx0 = this->gradX + (yi << this->shift);
+        const float* gy0 = this->gradY + (yi << this->shift);
+        const float* gx1 = this->gradX + (((yi + 1) & this->mask) << this->shift);
+        const float* gy1 = this->gradY + (((yi + 1) & this->mask) << this->shift);
+        __m128 yf = _mm_set1_ps(y - fy);
+        __m128 yf1 = _mm_sub_ps(yf, one);
+        __m128 v = _mm_set1_ps(fade(y - fy));
+        float* row = out + j * width;
+
+        int i = 0;
+        for (; i + 4 <= width; i += 4) {
+            __m128 idx = _mm_cvtepi32_ps(_mm_add_epi32(_mm_set1_epi32(i), _mm_set_epi32(3, 2, 1, 0)));
+            __m128 x = _mm_add_ps(vx0, _mm_mul_ps(idx, vstep));
+            // floor without SSE4.1: truncate, then step down where that rounded up
+            __m128i t = _mm_cvttps_epi32(x);
+            t = _mm_add_epi32(t, _mm_castps_si128(_mm_cmpgt_ps(_mm_cvtepi32_ps(t), x)));
+            __m128 xf = _mm_sub_ps(x, _mm_cvtepi32_ps(t));
+            __m128 xf1 = _mm_sub_ps(xf, one);
+            _mm_storeu_si128((__m128i*)xi, _mm_and_si128(t, mask));
+            _mm_storeu_si128((__m128i*)xi1, _mm_and_si128(_mm_add_epi32(t, _mm_set1_epi32(1)), mask));
+            for (int k = 0; k < 4; k++) {
+                g[0][k] = gx0[xi[k]]; g[1][k] = gy0[xi[k]];
+                g[2][k] = gx0[xi1[k]]; g[3][k] = gy0[xi1[k]];
+                g[4][k] = gx1[xi[k]]; g[5][k] = gy1[xi[k]];
+                g[6][k] = gx1[xi1[k]]; g[7][k] = gy1[xi1[k]];
+            }
+            __m128 n00 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(g[0]), xf),  _mm_mul_ps(_mm_loadu_ps(g[1]), yf));
+            __m128 n10 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(g[2]), xf1), _mm_mul_ps(_mm_loadu_ps(g[3]), yf));
+            __m128 n01 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(g[4]), xf),  _mm_mul_ps(_mm_loadu_ps(g[5]), yf1));
+            __m128 n11 = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(g[6]), xf1), _mm_mul_ps(_mm_loadu_ps(g[7]), yf1));
+
+            __m128 u = _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(xf, xf), xf),
+                                  _mm_add_ps(_mm_mul_ps(xf, _mm_sub_ps(_mm_mul_ps(xf, c6), c15)), c10));
+            __m128 x1 = _mm_add_ps(n00, _mm_mul_ps(u, _mm_sub_ps(n10, n00)));
+            __m128 x2 = _mm_add_ps(n01, _mm_mul_ps(u, _mm_sub_ps(n11, n01)));
+            _mm_storeu_ps(row + i, _mm_add_ps(x1, _mm_mul_ps(v, _mm_sub_ps(x2, x1))));
+        }
+        for (; i < width; i++)
+            row[i] = Perlin_sample(this, x0 + (float)i * step, y);
+    }
+}
+
+__attribute__((target("avx2")))
+static void Perlin_fillGridAVX2(struct PerlinNoise* this, float* out, int width, int height, float x0, float y0, float step) {
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 c6 = _mm256_set1_ps(6.0f), c15 = _mm256_set1_ps(15.0f), c10 = _mm256_set1_ps(10.0f);
+    const __m256i mask = _mm256_set1_epi32(this->mask);
+    const __m256 vx0 = _mm256_set1_ps(x0), vstep = _mm256_set1_ps(step);
+    const __m256i lanes = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    for (int j = 0; j < height; j++) {
+        float y = y0 + (float)j * step;
+        float fy = floorf(y);
+        int yi = (int)fy & this->mask;
+        const float* gx0 = this->gradX + (yi << this->shift);
+        const float* gy0 = this->gradY + (yi << this->shift);
+        const float* gx1 = this->gradX + (((yi + 1) & this->mask) << this->shift);
+        const float* gy1 = this->gradY + (((yi + 1) & this->mask) << this->shift);
+        __m256 yf = _mm256_set1_ps(y - fy);
+        __m256 yf1 = _mm256_sub_ps(yf, one);
+        __m256 v = _mm256_set1_ps(fade(y - fy));
+        float* row = out + j * width;
+
+        int i = 0;
+        for (; i + 8 <= width; i += 8) {
+            __m256 idx = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_set1_epi32(i), lanes));
+            __m256 x = _mm256_add_ps(vx0, _mm256_mul_ps(idx, vstep));
+            __m256 fx = _mm256_floor_ps(x);
+            __m256i t = _mm256_cvttps_epi32(fx);
+            __m256 xf = _mm256_sub_ps(x, fx);
+            __m256 xf1 = _mm256_sub_ps(xf, one);
+            __m256i xi = _mm256_and_si256(t, mask);
+            __m256i xi1 = _mm256_and_si256(_mm256_add_epi32(t, _mm256_set1_epi32(1)), mask);
+
+            __m256 n00 = _mm256_add_ps(_mm256_mul_ps(_mm256_i32gather_ps(gx0, xi, 4), xf),
+                                       _mm256_mul_ps(_mm256_i32gather_ps(gy0, xi, 4), yf));
+            __m256 n10 = _mm256_add_ps(_mm256_mul_ps(_mm256_i32gather_ps(gx0, xi1, 4), xf1),
+                                       _mm256_mul_ps(_mm256_i32gather_ps(gy0, xi1, 4), yf));
+            __m256 n01 = _mm256_add_ps(_mm256_mul_ps(_mm256_i32gather_ps(gx1, xi, 4), xf),
+                                       _mm256_mul_ps(_mm256_i32gather_ps(gy1, xi, 4), yf1));
+            __m256 n11 = _mm256_add_ps(_mm256_mul_ps(_mm256_i32gather_ps(gx1, xi1, 4), xf1),
+                                       _mm256_mul_ps(_mm256_i32gather_ps(gy1, xi1, 4), yf1));
+
+            __m256 u = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(xf, xf), xf),
+                                     _mm256_add_ps(_mm256_mul_ps(xf, _mm256_sub_ps(_mm256_mul_ps(xf, c6), c15)), c10));
+            __m256 x1 = _mm256_add_ps(n00, _mm256_mul_ps(u, _mm256_sub_ps(n10, n00)));
+            __m256 x2 = _mm256_add_ps(n01, _mm256_mul_ps(u, _mm256_sub_ps(n11, n01)));
+            _mm256_storeu_ps(row + i, _mm256_add_ps(x1, _mm256_mul_ps(v, _mm256_sub_ps(x2, x1))));
+        }
+        for (; i < width; i++)
+            row[i] = Perlin_sample(this, x0 + (float)i * step, y);
+    }
+}
+#endif
+
+// 2D fractal sum, one fillGrid per octave so the SIMD kernel does the work
+static void Perlin_fillGridFractal(struct PerlinNoise* this, float* out, int width, int height, float x0, float y0, float step, struct PerlinFractal fractal) {
+    float* octave = (float*)malloc(width * height * sizeof(float));
+    float amplitude = 1.0f, total = 0.0f;
+    for (int i = 0; i < width * height; i++)
+        out[i] = 0.0f;
+
+    for (int o = 0; o < fractal.octaves; o++) {
+        float offset = o * 31.7f; // keep octaves from sharing a lattice origin
+        this->fillGrid(this, octave, width, height, x0 + offset, y0 + offset, step);
+        for (int i = 0; i < width * height; i++) {
+            float n = octave[i];
+            if (fractal.ridged) {
+                n = 1.0f - fabsf(n);
+                n *= n;
+            }
+            out[i] += amplitude * n;
+        }
+        total += amplitude;
+        amplitude *= fractal.gain;
+        x0 *= fractal.lacunarity;
+        y0 *= fractal.lacunarity;
+        step *= fractal.lacunarity;
+    }
+
+    for (int i = 0; i < width * height; i++)
+        out[i] = fractal.ridged ? out[i] / total * 2.0f - 1.0f : out[i] / total;
+    free(octave);
+}
+
+// single point, same octave sum as Perlin_fillGridFractal without its buffer
+static float perlinFractalAt(struct PerlinNoise* this, struct Vec2 position, struct PerlinFractal fractal) {
+    float x = position.x, y = position.y;
+    float amplitude = 1.0f, total = 0.0f, sum = 0.0f;
+    for (int o = 0; o < fractal.octaves; o++) {
+        float offset = o * 31.7f;
+        float n = Perlin_sample(this, x + offset, y + offset);
+        if (fractal.ridged) {
+            n = 1.0f - fabsf(n);
+            n *= n;
+        }
+        sum += amplitude * n;
+        total += amplitude;
+        amplitude *= fractal.gain;
+        x *= fractal.lacunarity;
+        y *= fractal.lacunarity;
+    }
+    return fractal.ridged ? sum / total * 2.0f - 1.0f : sum / total;
+}
+
+// improved-noise edge gradients, padded to 16 so a hash picks one with & 15
+static const float PERLIN_GRAD3[16][3] = {
+    { 1, 1, 0}, {-1, 1, 0}, { 1,-1, 0}, {-1,-1, 0},
+    { 1, 0, 1}, {-1, 0, 1}, { 1, 0,-1}, {-1, 0,-1},
+    { 0, 1, 1}, { 0,-1, 1}, { 0, 1,-1}, { 0,-1,-1},
+    { 1, 1, 0}, { 0,-1, 1}, {-1, 1, 0}, { 0,-1,-1}
+};
+
+static inline float Perlin_grad3(int hash, float x, float y, float z) {
+    const float* g = PERLIN_GRAD3[hash & 15];
+    return g[0] * x + g[1] * y + g[2] * z;
+}
+
+// Lattice points hash as perm[perm[perm[x] + z] + y], x and z first so a
+// column of samples shares everything but the last lookup.
+static inline int Perlin_hashColumn(const struct PerlinNoise* this, int xi, int zi) {
+    return this->perm[(this->perm[xi] + zi) & this->mask];
+}
+
+static inline float Perlin_sample3(const struct PerlinNoise* this, float x, float y, float z) {
+    float fx = floorf(x), fy = floorf(y), fz = floorf(z);
+    int m = this->mask;
+    int xi = (int)fx & m, yi = (int)fy & m, zi = (int)fz & m;
+    int xi1 = (xi + 1) & m, yi1 = (yi + 1) & m, zi1 = (zi + 1) & m;
+    float xf = x - fx, yf = y - fy, zf = z - fz;
+    float u = fade(xf), v = fade(yf), w = fade(zf);
+
+    int c00 = Perlin_hashColumn(this, xi, zi),  c10 = Perlin_hashColumn(this, xi1, zi);
+    int c01 = Perlin_hashColumn(this, xi, zi1), c11 = Perlin_hashColumn(this, xi1, zi1);
+    const int* p = this->perm;
+
+    // x, then z, then y, the order fillVolume uses
+    float b0 = lerp(lerp(Perlin_grad3(p[(c00 + yi) & m], xf, yf, zf),     Perlin_grad3(p[(c10 + yi) & m], xf - 1, yf, zf), u),
+                    lerp(Perlin_grad3(p[(c01 + yi) & m], xf, yf, zf - 1), Perlin_grad3(p[(c11 + yi) & m], xf - 1, yf, zf - 1), u), w);
+    float b1 = lerp(lerp(Perlin_grad3(p[(c00 + yi1) & m], xf, yf - 1, zf),     Perlin_grad3(p[(c10 + yi1) & m], xf - 1, yf - 1, zf), u),
+                    lerp(Perlin_grad3(p[(c01 + yi1) & m], xf, yf - 1, zf - 1), Perlin_grad3(p[(c11 + yi1) & m], xf - 1, yf - 1, zf - 1), u), w);
+    return lerp(b0, b1, v);
+}
+
+static float perlinNoise3At(struct PerlinNoise* this, float x, float y, float z) {
+    return Perlin_sample3(this, x, y, z);
+}
+
+// 3D fractal volume. Per octave the y terms are computed once for the
+// whole volume and the x/z lattice hashes, fractions and fades once per
+// column, so the inner y loop is only the last hash and the dot products.
+static void Perlin_fillVolume(struct PerlinNoise* this, float* out, int sx, int sy, int sz, float x0, float y0, float z0, float step, float stepY, struct PerlinFractal fractal) {
+    int m = this->mask;
+    const int* p = this->perm;
+    int* yiA = (int*)malloc(sy * 2 * sizeof(int));
+    float* yfA = (float*)malloc(sy * 2 * sizeof(float));
+    int* yi1A = yiA + sy;
+    float* vA = yfA + sy;
+    float amplitude = 1.0f, total = 0.0f;
+    for (int i = 0; i < sx * sy * sz; i++)
+        out[i] = 0.0f;
+
+    for (int o = 0; o < fractal.octaves; o++) {
+        float offset = o * 31.7f;
+        for (int y = 0; y < sy; y++) {
+            float py = y0 + offset + (float)y * stepY;
+            float fy = floorf(py);
+            yiA[y] = (int)fy & m;
+            yi1A[y] = (yiA[y] + 1) & m;
+            yfA[y] = py - fy;
+            vA[y] = fade(py - fy);
+        }
+        for (int z = 0; z < sz; z++) {
+            float pz = z0 + offset + (float)z * step;
+            float fz = floorf(pz);
+            int zi = (int)fz & m, zi1 = (zi + 1) & m;
+            float zf = pz - fz, w = fade(zf);
+            for (int x = 0; x < sx; x++) {
+                float px = x0 + offset + (float)x * step;
+                float fx = floorf(px);
+                int xi = (int)fx & m, xi1 = (xi + 1) & m;
+                float xf = px - fx, u = fade(xf);
+                int c00 = Perlin_hashColumn(this, xi, zi),  c10 = Perlin_hashColumn(this, xi1, zi);
+                int c01 = Perlin_hashColumn(this, xi, zi1), c11 = Perlin_hashColumn(this, xi1, zi1);
+                float* column = out + x + z * sx * sy;
+
+                for (int y = 0; y < sy; y++) {
+                    int yi = yiA[y], yi1 = yi1A[y];
+                    float yf = yfA[y];
+                    float b0 = lerp(lerp(Perlin_grad3(p[(c00 + yi) & m], xf, yf, zf),     Perlin_grad3(p[(c10 + yi) & m], xf - 1, yf, zf), u),
+                                    lerp(Perlin_grad3(p[(c01 + yi) & m], xf, yf, zf - 1), Perlin_grad3(p[(c11 + yi) & m], xf - 1, yf, zf - 1), u), w);
+                    float b1 = lerp(lerp(Perlin_grad3(p[(c00 + yi1) & m], xf, yf - 1, zf),     Perlin_grad3(p[(c10 + yi1) & m], xf - 1, yf - 1, zf), u),
+                                    lerp(Perlin_grad3(p[(c01 + yi1) & m], xf, yf - 1, zf - 1), Perlin_grad3(p[(c11 + yi1) & m], xf - 1, yf - 1, zf - 1), u), w);
+                    float n = lerp(b0, b1, vA[y]);
+                    if (fractal.ridged) {
+                        n = 1.0f - fabsf(n);
+                        n *= n;
+                    }
+                    column[y * sx] += amplitude * n;
+                }
+            }
+        }
+        total += amplitude;
+        amplitude *= fractal.gain;
+        x0 *= fractal.lacunarity;
+        y0 *= fractal.lacunarity;
+        z0 *= fractal.lacunarity;
+        step *= fractal.lacunarity;
+        stepY *= fractal.lacunarity;
+    }
+
+    for (int i = 0; i < sx * sy * sz; i++)
+        out[i] = fractal.ridged ? out[i] / total * 2.0f - 1.0f : out[i] / total;
+    free(yiA);
+    free(yfA);
+}
+
+typedef void (*PerlinFillGridFunc)(struct PerlinNoise* this, float* out, int width, int height, float x0, float y0, float step);
+
+// widest kernel this CPU runs
+static PerlinFillGridFunc Perlin_pickFillGrid(void) {
+#ifdef PERLIN_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return &Perlin_fillGridAVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return &Perlin_fillGridSSE2;
+#endif
+    return &Perlin_fillGridScalar;
+}
+
 static void destroyPerlin(struct PerlinNoise* this) {
-    this->vectors.destroy(&this->vectors);
+    free(this->gradX);
+    free(this->gradY);
+    free(this->perm);
+    this->gradX = this->gradY = NULL;
+    this->perm = NULL;
 }
 
-inline static struct PerlinNoise newPerlinNoise(int dimension) {
+// same seed, same gradients
+inline static struct PerlinNoise newSeededPerlinNoise(int dimension, uint64_t seed) {
     struct PerlinNoise pn;
-    pn.dimension = dimension;
-    pn.vectors = Vector.new(dimension * dimension, FIELD_TYPE_VEC2);
-
-    for (int y = 0; y < dimension; y++) {
-        for (int x = 0; x < dimension; x++) {
-            float angle = ((float)rand() / RAND_MAX) * 2.0f * M_PI;
-            struct Vec2 g = Vec2.new(cosf(angle), sinf(angle));
-            pn.vectors.push_back(&pn.vectors, &g);
-        }
+    pn.dimension = 1;
+    pn.shift = 0;
+    while (pn.dimension < dimension) {
+        pn.dimension <<= 1;
+        pn.shift++;
+    }
+    pn.mask = pn.dimension - 1;
+    pn.gradX = (float*)malloc(pn.dimension * pn.dimension * sizeof(float));
+    pn.gradY = (float*)malloc(pn.dimension * pn.dimension * sizeof(float));
+
+    uint64_t state = seed;
+    for (int i = 0; i < pn.dimension * pn.dimension; i++) {
+        float angle = (float)(Perlin_nextRandom(&state) >> 40) / (float)(1 << 24) * 2.0f * M_PI;
+        pn.gradX[i] = cosf(angle);
+        pn.gradY[i] = sinf(angle);
+    }
+    pn.perm = (int*)malloc(pn.dimension * sizeof(int));
+    for (int i = 0; i < pn.dimension; i++)
+        pn.perm[i] = i;
+    for (int i = pn.dimension - 1; i > 0; i--) {
+        int j = (int)(Perlin_nextRandom(&state) % (uint64_t)(i + 1));
+        int t = pn.perm[i];
+        pn.perm[i] = pn.perm[j];
+        pn.perm[j] = t;
     }
 
     pn.noiseAt = &perlinNoiseAt;
+    pn.noise3At = &perlinNoise3At;
+    pn.fractalAt = &perlinFractalAt;
+    pn.fillGrid = Perlin_pickFillGrid();
+    pn.fillGridFractal = &Perlin_fillGridFractal;
+    pn.fillVolume = &Perlin_fillVolume;
     pn.destroy = &destroyPerlin;
     return pn;
 }
 
+// seeded from rand(), differs per run unless srand() was called
+inline static struct PerlinNoise newPerlinNoise(int dimension) {
+    return newSeededPerlinNoise(dimension, (uint64_t)rand());
+}
+
 static const struct {
     struct PerlinNoise (*new)(int dimension);
+    struct PerlinNoise (*seeded)(int dimension, uint64_t seed);
 } PerlinNoise = {
-    .new = &newPerlinNoise
+    .new = &newPerlinNoise,
+    .seeded = &newSeededPerlinNoise
 };
 
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT DEFAULT
+#elif defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+
 #endif
@@ -0,0 +1,437 @@
+#ifndef REGION_H_
+#define REGION_H_
+    #include "Chunk.h"
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <string.h>
+    #include <stdint.h>
+    #include <pthread.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+
+    // Chunk persistence. Chunks are grouped REGION_SIZE x REGION_SIZE per
+    // file, "<dir>/r.<rx>.<rz>.frr":
+    //   header   "FRRG", u16 version, u8 CHUNK_SIZE_SHIFT, u8 CHUNK_HEIGHT_SHIFT, 8 bytes reserved
+    //   table    REGION_SIZE^2 entries of {u32 offset, u32 length}, 0 = not stored
+    //   records  u32 RLE length, then the RLE stream compressed with RegionLZ
+    // All integers are little endian. Saving rewrites the chunk's record in
+    // place when the new one fits or the old one ends the file, otherwise
+    // appends it, and then rewrites only its table entry, so a save costs
+    // what the chunk compresses to no matter how big the region is; records
+    // that outgrew their slot stay behind as garbage. Offsets are u32: a save
+    // that would put a record past 4 GiB is refused. Files are read through a
+    // read-only mmap.
+    #define REGION_SHIFT 5
+    #define REGION_SIZE (1 << REGION_SHIFT)
+    #define REGION_CHUNKS (REGION_SIZE * REGION_SIZE)
+    #define REGION_VERSION 1
+    #define REGION_HEADER_BYTES 16
+    #define REGION_DATA_START (REGION_HEADER_BYTES + REGION_CHUNKS * 8)
+
+    static inline void Region_put32(uint8_t* p, uint32_t v) {
+        p[0] = (uint8_t)v; p[1] = (uint8_t)(v >> 8); p[2] = (uint8_t)(v >> 16); p[3] = (uint8_t)(v >> 24);
+    }
+
+    static inline uint32_t Region_get32(const uint8_t* p) {
+        return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+    }
+
+    // Run-length pass over the CHUNK_INDEX array: (run - 1, block) byte pairs,
+    // runs up to 256. Air layers and solid floors collapse to a few pairs.
+    // out needs room for 2 * n bytes; returns the bytes written.
+    static int RegionRLE_encode(const Block* in, int n, uint8_t* out) {
+        int o = 0;
+        for (int i = 0; i < n;) {
+            int run = 1;
+            while (i + run < n && run < 256 && in[i + run] == in[i])
+                run++;
+            out[o++] = (uint8_t)(run - 1);
+            out[o++] = in[i];
+            i += run;
+        }
+        return o;
+    }
+
+    // returns 0 unless exactly n blocks were decoded
+    static int RegionRLE_decode(const uint8_t* in, int length, Block* out, int n) {
+        int o = 0;
+        for (int i = 0; i + 1 < length; i += 2) {
+            int run = in[i] + 1;
+            if (o + run > n) return 0;
+            memset(out + o, in[i + 1], run);
+            o += run;
+        }
+        return o == n;
+    }
+
+    // Byte-oriented LZ77 in the style of LZ4: each sequence is a token
+    // (literal count << 4 | match length - 4, 15 = more length bytes follow,
+    // each adding up to 255), the literals, then a 16-bit back offset. The
+    // last sequence is literals only. Matches are found through a hash of
+    // the next four bytes, one candidate per slot.
+    #define REGIONLZ_HASH_BITS 12
+    #define REGIONLZ_MIN_MATCH 4
+
+    // worst case compressed size for n input bytes
+    #define REGIONLZ_BOUND(n) ((n) + (n) / 255 + 16)
+
+    static inline uint32_t RegionLZ_hash(const uint8_t* p) {
+        uint32_t v = (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+        return (v * 2654435761u) >> (32 - REGIONLZ_HASH_BITS);
+    }
+
+    static inline uint8_t* RegionLZ_putLength(uint8_t* out, int length) {
+        while (length >= 255) {
+            *out++ = 255;
+            length -= 255;
+        }
+        *out++ = (uint8_t)length;
+        return out;
+    }
+
+    static uint8_t* RegionLZ_sequence(uint8_t* out, const uint8_t* literals, int literalCount, int offset, int matchLength) {
+        uint8_t* token = out++;
+        int lit = literalCount < 15 ? literalCount : 15;
+        int mat = 0;
+        if (offset) {
+            mat = matchLength - REGIONLZ_MIN_MATCH;
+            mat = mat < 15 ? mat : 15;
+        }
+        *token = (uint8_t)(lit << 4 | mat);
+        if (literalCount >= 15)
+            out = RegionLZ_putLength(out, literalCount - 15);
+        memcpy(out, literals, literalCount);
+        out += literalCount;
+        if (offset) {
+            *out++ = (uint8_t)offset;
+            *out++ = (uint8_t)(offset >> 8);
+            if (matchLength - REGIONLZ_MIN_MATCH >= 15)
+                out = RegionLZ_putLength(out, matchLength - REGIONLZ_MIN_MATCH - 15);
+        }
+        return out;
+    }
+
+    // out needs REGIONLZ_BOUND(n) bytes; returns the bytes written
+    static int RegionLZ_compress(const uint8_t* in, int n, uint8_t* out) {
+        int table[1 << REGIONLZ_HASH_BITS];
+        for (int i = 0; i < (1 << REGIONLZ_HASH_BITS); i++)
+            table[i] = -1;
+
+        uint8_t* o = out;
+        int anchor = 0, i = 0;
+        while (i + REGIONLZ_MIN_MATCH <= n) {
+            uint32_t h = RegionLZ_hash(in + i);
+            int candidate = table[h];
+            table[h] = i;
+            if (candidate < 0 || i - candidate > 65535 || memcmp(in + candidate, in + i, REGIONLZ_MIN_MATCH) != 0) {
+                i++;
+                continue;
+            }
+            int length = REGIONLZ_MIN_MATCH;
+            while (i + length < n && in[candidate + length] == in[i + length])
+                length++;
+            o = RegionLZ_sequence(o, in + anchor, i - anchor, i - candidate, length);
+            i += length;
+            anchor = i;
+        }
+        o = RegionLZ_sequence(o, in + anchor, n - anchor, 0, 0);
+        return (int)(o - out);
+    }
+
+    static inline int RegionLZ_getLength(const uint8_t** p, const uint8_t* end, int length) {
+        if (length != 15) return length;
+        uint8_t b;
+        do {
+            if (*p >= end) return -1;
+            b = *(*p)++;
+            length += b;
+        } while (b == 255);
+        return length;
+    }
+
+    // returns the bytes written to out, or -1 on corrupt input
+    static int RegionLZ_decompress(const uint8_t* in, int length, uint8_t* out, int capacity) {
+        const uint8_t* p = in;
+        const uint8_t* end = in + length;
+        int o = 0;
+        while (p < end) {
+            int token = *p++;
+            int literals = RegionLZ_getLength(&p, end, token >> 4);
+            if (literals < 0 || literals > end - p || o + literals > capacity) return -1;
+            memcpy(out + o, p, literals);
+            p += literals;
+            o += literals;
+            if (p == end) break; // last sequence has no match
+
+            if (end - p < 2) return -1;
+            int offset = p[0] | p[1] << 8;
+            p += 2;
+            int match = RegionLZ_getLength(&p, end, token & 15);
+            if (match < 0 || offset == 0 || offset > o) return -1;
+            match += REGIONLZ_MIN_MATCH;
+            if (o + match > capacity) return -1;
+            for (int k = 0; k < match; k++, o++) // may overlap, copy forward
+                out[o] = out[o - offset];
+        }
+        return o;
+    }
+
+    struct Region {
+        int rx, rz;
+        int fd;                                  // -1 while the file does not exist
+        int checked;                             // looked for the file already
+        int rejected;                            // file from another format or build, left alone
+        uint8_t* map;                            // read-only view of the whole file
+        size_t mapSize;
+        uint32_t table[REGION_CHUNKS][2];        // offset, length
+        struct Region* next;
+    };
+
+    struct RegionStoreState {
+        char* directory;
+        pthread_rwlock_t lock;                   // readers decode, the writer saves or opens
+        struct Region* regions;
+        int saved;                               // chunks written
+        long bytesWritten;
+    };
+
+    // Loads may run on any number of threads at once; saves are serialized
+    // against them and each other.
+    struct RegionStore {
+        struct RegionStoreState* state;
+        int (*load)(struct RegionStore* this, struct Chunk* chunk, int cx, int cz);
+        int (*save)(struct RegionStore* this, struct Chunk* chunk, int cx, int cz);
+        void (*destroy)(struct RegionStore* this);
+    };
+
+    static void Region_remap(struct Region* r) {
+        if (r->map) munmap(r->map, r->mapSize);
+        r->map = NULL;
+        r->mapSize = 0;
+        struct stat st;
+        if (r->fd < 0 || fstat(r->fd, &st) != 0 || st.st_size < REGION_DATA_START)
+            return;
+        void* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, r->fd, 0);
+        if (map == MAP_FAILED)
+            return;
+        r->map = (uint8_t*)map;
+        r->mapSize = st.st_size;
+    }
+
+    static void Region_path(struct RegionStoreState* s, int rx, int rz, char* out, size_t size) {
+        snprintf(out, size, "%s/r.%d.%d.frr", s->directory, rx, rz);
+    }
+
+    // caller holds the write lock; create makes the file if it is missing
+    static struct Region* Region_open(struct RegionStoreState* s, int rx, int rz, int create) {
+        struct Region* r = s->regions;
+        while (r && (r->rx != rx || r->rz != rz))
+            r = r->next;
+        if (!r) {
+            r = (struct Region*)calloc(1, sizeof(struct Region));
+            r->rx = rx;
+            r->rz = rz;
+            r->fd = -1;
+            r->next = s->regions;
+            s->regions = r;
+        }
+        if (r->fd >= 0 || r->rejected || (r->checked && !create))
+            return r;
+
+        char path[1024];
+        Region_path(s, rx, rz, path, sizeof(path));
+        r->checked = 1;
+        r->fd = open(path, O_RDWR);
+        if (r->fd >= 0) {
+            Region_remap(r);
+            const uint8_t* h = r->map;
+            if (!h || r->mapSize < REGION_DATA_START || memcmp(h, "FRRG", 4) != 0 || (h[4] | h[5] << 8) != REGION_VERSION ||
+                h[6] != CHUNK_SIZE_SHIFT || h[7] != CHUNK_HEIGHT_SHIFT) {
+                printf("Region file %s does not match this build, ignoring it\n", path);
+                close(r->fd);
+                if (r->map) munmap(r->map, r->mapSize);
+                r->map = NULL;
+                r->fd = -1;
+                r->rejected = 1;
+                return r;
+            }
+            for (int i = 0; i < REGION_CHUNKS; i++) {
+                r->table[i][0] = Region_get32(h + REGION_HEADER_BYTES + i * 8);
+                r->table[i][1] = Region_get32(h + REGION_HEADER_BYTES + i * 8 + 4);
+            }
+            return r;
+        }
+        if (!create)
+            return r;
+
+        r->fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (r->fd < 0) {
+            printf("Failed to create region file: %s\n", path);
+            return r;
+        }
+        uint8_t* header = (uint8_t*)calloc(1, REGION_DATA_START);
+        memcpy(header, "FRRG", 4);
+        header[4] = REGION_VERSION & 255;
+        header[5] = REGION_VERSION >> 8;
+        header[6] = CHUNK_SIZE_SHIFT;
+        header[7] = CHUNK_HEIGHT_SHIFT;
+        if (pwrite(r->fd, header, REGION_DATA_START, 0) != REGION_DATA_START)
+            printf("Failed to write region header: %s\n", path);
+        free(header);
+        memset(r->table, 0, sizeof(r->table));
+        Region_remap(r);
+        return r;
+    }
+
+    static inline int Region_slot(int cx, int cz) {
+        return (cx & (REGION_SIZE - 1)) + (cz & (REGION_SIZE - 1)) * REGION_SIZE;
+    }
+
+    // fill chunk from disk; 0 when the chunk was never saved. The chunk is
+    // left clean (no dirty or unsaved flag), callers link and mesh it.
+    static int RegionStore_load(struct RegionStore* this, struct Chunk* chunk, int cx, int cz) {
+        struct RegionStoreState* s = this->state;
+        int rx = cx >> REGION_SHIFT, rz = cz >> REGION_SHIFT;
+
+        pthread_rwlock_rdlock(&s->lock);
+        struct Region* r = s->regions;
+        while (r && (r->rx != rx || r->rz != rz))
+            r = r->next;
+        if (!r) {
+            pthread_rwlock_unlock(&s->lock);
+            pthread_rwlock_wrlock(&s->lock);
+            Region_open(s, rx, rz, 0);
+            pthread_rwlock_unlock(&s->lock);
+            pthread_rwlock_rdlock(&s->lock);
+            r = s->regions;
+            while (r && (r->rx != rx || r->rz != rz))
+                r = r->next;
+        }
+
+        int ok = 0;
+        int slot = Region_slot(cx, cz);
+        uint32_t offset = r->table[slot][0], length = r->table[slot][1];
+        // the table comes from the file: check it without letting
+        // offset + length wrap, and never point a record into the header
+        if (r->map && offset >= REGION_DATA_START && length >= 4 &&
+            length <= 4 + REGIONLZ_BOUND(2 * CHUNK_VOLUME) &&
+            offset <= r->mapSize && length <= r->mapSize - offset) {
+            const uint8_t* record = r->map + offset;
+            // validate the stored size before allocating for it
+            uint32_t rleLength = Region_get32(record);
+            if (rleLength > 0 && rleLength <= 2 * CHUNK_VOLUME) {
+                uint8_t* rle = (uint8_t*)malloc(rleLength);
+                Block* blocks = (Block*)malloc(CHUNK_VOLUME);
+                if (rle && blocks &&
+                    RegionLZ_decompress(record + 4, (int)length - 4, rle, (int)rleLength) == (int)rleLength &&
+                    RegionRLE_decode(rle, (int)rleLength, blocks, CHUNK_VOLUME) &&
+                    Chunk_fillBlocks(chunk, blocks)) {
+                    chunk->unsaved = 0;
+                    ok = 1;
+                }
+                free(rle);
+                free(blocks);
+            }
+        }
+        pthread_rwlock_unlock(&s->lock);
+        return ok;
+    }
+
+    // write the chunk if it has unsaved changes; returns 1 when written
+    static int RegionStore_save(struct RegionStore* this, struct Chunk* chunk, int cx, int cz) {
+        struct RegionStoreState* s = this->state;
+        if (!chunk->unsaved)
+            return 0;
+
+        // compress outside the lock
+        Block* blocks = (Block*)malloc(CHUNK_VOLUME);
+        uint8_t* rle = (uint8_t*)malloc(2 * CHUNK_VOLUME);
+        Chunk_copyBlocks(chunk, blocks);
+        int rleLength = RegionRLE_encode(blocks, CHUNK_VOLUME, rle);
+        uint8_t* record = (uint8_t*)malloc(4 + REGIONLZ_BOUND(rleLength));
+        Region_put32(record, (uint32_t)rleLength);
+        int length = 4 + RegionLZ_compress(rle, rleLength, record + 4);
+        free(blocks);
+        free(rle);
+
+        pthread_rwlock_wrlock(&s->lock);
+        struct Region* r = Region_open(s, cx >> REGION_SHIFT, cz >> REGION_SHIFT, 1);
+        int ok = 0;
+        int slot = Region_slot(cx, cz);
+        off_t offset = -1;
+        int last = 0;
+        if (r->fd >= 0) {
+            // reuse the old slot when the record still fits or is the last
+            // one in the file, else append
+            off_t end = lseek(r->fd, 0, SEEK_END);
+            uint32_t oldOffset = r->table[slot][0], oldLength = r->table[slot][1];
+            offset = end;
+            if (oldOffset >= REGION_DATA_START && oldOffset <= r->mapSize &&
+                oldLength <= r->mapSize - oldOffset) {
+                last = (off_t)oldOffset + oldLength == end;
+                if ((uint32_t)length <= oldLength || last)
+                    offset = oldOffset;
+            }
+        }
+        if (offset >= 0 && (uint64_t)offset + (uint64_t)length <= UINT32_MAX) {
+            uint8_t entry[8];
+            Region_put32(entry, (uint32_t)offset);
+            Region_put32(entry + 4, (uint32_t)length);
+            // record first, then the table entry that points at it
+            if (pwrite(r->fd, record, length, offset) == length &&
+                pwrite(r->fd, entry, 8, REGION_HEADER_BYTES + slot * 8) == 8) {
+                // a shorter tail record leaves the old one's end behind; a
+                // failed trim only keeps a few unused bytes
+                if (last && ftruncate(r->fd, offset + length) != 0)
+                    last = 0;
+                r->table[slot][0] = (uint32_t)offset;
+                r->table[slot][1] = (uint32_t)length;
+                Region_remap(r);
+                s->saved++;
+                s->bytesWritten += length;
+                chunk->unsaved = 0;
+                ok = 1;
+            }
+        }
+        pthread_rwlock_unlock(&s->lock);
+        free(record);
+        return ok;
+    }
+
+    static void RegionStore_destroy(struct RegionStore* this) {
+        struct RegionStoreState* s = this->state;
+        if (!s) return;
+        struct Region* r = s->regions;
+        while (r) {
+            struct Region* next = r->next;
+            if (r->map) munmap(r->map, r->mapSize);
+            if (r->fd >= 0) close(r->fd);
+            free(r);
+            r = next;
+        }
+        pthread_rwlock_destroy(&s->lock);
+        free(s->directory);
+        free(s);
+        this->state = NULL;
+    }
+
+    // directory must exist
+    static struct RegionStore newRegionStore(const char* directory) {
+        struct RegionStoreState* s = (struct RegionStoreState*)calloc(1, sizeof(struct RegionStoreState));
+        s->directory = strdup(directory);
+        pthread_rwlock_init(&s->lock, NULL);
+        return (struct RegionStore) {
+            .state = s,
+            .load = &RegionStore_load,
+            .save = &RegionStore_save,
+            .destroy = &RegionStore_destroy,
+        };
+    }
+
+    static const struct {
+        struct RegionStore (*new)(const char* directory);
+    } RegionStore = { .new = &newRegionStore };
+
+#endif
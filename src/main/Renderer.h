@@ -4,10 +4,12 @@
     #include "Textures.h"
     #include "Chunk.h"
     #include "World.h"
+    #include "Frustum.h"
     struct Renderer {
         void(*render)(struct Model* model, struct Texture* texture);
         void(*renderChunk)(struct Chunk* chunk, struct Program* program);
-        void(*renderWorld)(struct World* world, struct Program* program);
+        void(*renderWorld)(struct World* world, struct Program* program, struct Frustum* frustum);
+        void(*occludeWorld)(struct World* world, struct OcclusionCuller* culler);
     };
 
     void render(struct Model* model, struct Texture* texture) {
@@ -23,28 +25,191 @@
     }
      void renderChunk(struct Chunk* chunk, struct Program* program) {
         struct Model* model = &chunk->mesh;
+        if (model->vaoID == 0 || model->vertexCount == 0)
+            return; // empty or buried, nothing to draw
         struct Mat4 mmodel = Mat4.new();
         struct Uniform umodel = Uniform.new(GL_MAT4, program, "model");
-        mmodel.transform(&mmodel, chunk->position->x*CHUNK_SIZE, 0,chunk->position->y*CHUNK_SIZE,0,0,0,1,1,1);
+        mat4_transform(&mmodel, chunk->position->x*CHUNK_SIZE, 0,chunk->position->y*CHUNK_SIZE,0,0,0,1,1,1);
         umodel.ld(&umodel, (void*)&mmodel);
+        // packed chunk meshes keep their single attribute enabled in the VAO
         glBindVertexArray(model->vaoID);
-        glEnableVertexAttribArray(0);
-        glEnableVertexAttribArray(1);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, model->iboID);
         glDrawElements(GL_TRIANGLES, model->vertexCount, GL_UNSIGNED_INT, 0);
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
-        glDisableVertexAttribArray(1);
-        glDisableVertexAttribArray(0);
         glBindVertexArray(0);
      }
      
-     void renderWorld(struct World* world, struct Program* program) {
-        for (int z = 0; z < world->depth; z++) {
-            for (int x = 0; x < world->width; x++) {
-                struct Chunk* chunk = World_getChunk(world, x, z);
-                renderChunk(chunk, program);
+     static inline int Renderer_chunkDrawable(struct Chunk* chunk) {
+        return chunk->mesh.vertexCount != 0 && (chunk->mesh.vaoID != 0 || chunk->batchPages != 0);
+     }
+
+     // batched worlds collect the chunk for one draw at the end of renderWorld
+     static inline void Renderer_drawChunk(struct World* world, struct Chunk* chunk, struct Program* program) {
+        struct ChunkBatch* batch = world->state->batch;
+        if (batch)
+            batch->add(batch, chunk);
+        else
+            renderChunk(chunk, program);
+     }
+
+     // chunk column bounds in world space, matching the model matrix renderChunk uploads
+     static int Renderer_chunkInFrustum(struct Chunk* chunk, struct Frustum* frustum) {
+        float x = chunk->position->x * CHUNK_SIZE;
+        float z = chunk->position->y * CHUNK_SIZE;
+        return Frustum_intersectsAABB(frustum, x, 0, z, x + CHUNK_SIZE, CHUNK_HEIGHT, z + CHUNK_SIZE);
+     }
+
+     // depth test against frustum->occlusion, on the blocks' real height rather than the column
+     static int Renderer_chunkHidden(struct Chunk* chunk, struct Frustum* frustum) {
+        if (!frustum->occlusion)
+            return 0;
+        float x = chunk->position->x * CHUNK_SIZE;
+        float z = chunk->position->y * CHUNK_SIZE;
+        return !frustum->occlusion->testAABB(frustum->occlusion, x, 0, z, x + CHUNK_SIZE, chunk->solidTop, z + CHUNK_SIZE);
+     }
+
+     // one step of the visibility walk: the chunk, the face it was entered
+     // through (-1 for the camera's own chunk) and every direction taken so far
+     struct RendererVisit {
+        struct WorldChunk* node;
+        int from;
+        int dirs;
+     };
+
+     // Breadth-first walk over the chunk grid from the camera. A chunk is
+     // left through face `to` only when its cave connectivity joins `to` to
+     // the face it was entered by, the step does not undo a direction the
+     // path already took, and the next chunk is inside the frustum. Chunks
+     // the walk never reaches are hidden behind rock. A camera above (or
+     // below) the world enters every chunk in the frustum through its top
+     // (or bottom) face. Returns 0 when the camera chunk is not resident or
+     // the walk queue cannot grow.
+     static int Renderer_walkVisible(struct World* world, struct Program* program, struct Frustum* frustum) {
+        int cx = (int)floorf(frustum->eye[0] / CHUNK_SIZE);
+        int cz = (int)floorf(frustum->eye[2] / CHUNK_SIZE);
+        float y = frustum->eye[1];
+        struct WorldChunk* start = World_findNode(world, cx, cz);
+        if (!start || world->loadedCount == 0)
+            return 0;
+
+        // every chunk is queued at most once, so loadedCount entries suffice
+        struct WorldState* s = world->state;
+        if (world->loadedCount > s->visitCapacity) {
+            int capacity = s->visitCapacity ? s->visitCapacity * 2 : 256;
+            while (capacity < world->loadedCount)
+                capacity *= 2;
+            struct RendererVisit* grown = (struct RendererVisit*)realloc(s->visitQueue, capacity * sizeof(struct RendererVisit));
+            if (!grown)
+                return 0; // draw with the frustum test alone
+            s->visitQueue = grown;
+            s->visitCapacity = capacity;
+        }
+
+        unsigned int frame = ++world->visitFrame;
+        struct RendererVisit* queue = s->visitQueue;
+        int head = 0, tail = 0;
+        if (y >= 0 && y < CHUNK_HEIGHT) {
+            start->visitFrame = frame;
+            queue[tail++] = (struct RendererVisit){ start, -1, 0 };
+        } else {
+            int from = y >= CHUNK_HEIGHT ? 4 : 5;
+            for (int i = 0; i < world->loadedCount; i++) {
+                struct WorldChunk* node = world->loaded[i];
+                node->visitFrame = frame;
+                if (Renderer_chunkInFrustum(&node->chunk, frustum))
+                    queue[tail++] = (struct RendererVisit){ node, from, 1 << oppositeFace(from) };
+            }
+        }
+
+        while (head < tail) {
+            struct RendererVisit v = queue[head++];
+            struct Chunk* chunk = &v.node->chunk;
+            if (Renderer_chunkDrawable(chunk) && Renderer_chunkInFrustum(chunk, frustum)) {
+                if (Renderer_chunkHidden(chunk, frustum)) {
+                    frustum->occluded++;
+                } else {
+                    frustum->visible++;
+                    Renderer_drawChunk(world, chunk, program);
+                }
+            }
+            // columns: only the four horizontal faces lead to another chunk
+            for (int dir = 0; dir < 4; dir++) {
+                if (v.dirs & (1 << oppositeFace(dir)))
+                    continue;
+                if (v.from >= 0 && !Chunk_canSeeThrough(chunk, v.from, dir))
+                    continue;
+                struct Chunk* next = chunk->neighbors[dir];
+                if (!next)
+                    continue;
+                struct WorldChunk* node = (struct WorldChunk*)next->owner;
+                if (node->visitFrame == frame)
+                    continue;
+                node->visitFrame = frame;
+                if (!Renderer_chunkInFrustum(next, frustum))
+                    continue;
+                queue[tail++] = (struct RendererVisit){ node, oppositeFace(dir), v.dirs | (1 << dir) };
             }
         }
+
+        // reached chunks inside the frustum were counted above
+        for (int i = 0; i < world->loadedCount; i++) {
+            struct WorldChunk* node = world->loaded[i];
+            if (!Renderer_chunkDrawable(&node->chunk))
+                continue;
+            if (!Renderer_chunkInFrustum(&node->chunk, frustum))
+                frustum->culled++;
+            else if (node->visitFrame != frame)
+                frustum->occluded++;
+        }
+        return 1;
+     }
+
+     // camera outside the resident area: frustum test only
+     static void Renderer_drawAll(struct World* world, struct Program* program, struct Frustum* frustum) {
+        for (int i = 0; i < world->loadedCount; i++) {
+            struct Chunk* chunk = &world->loaded[i]->chunk;
+            if (!Renderer_chunkDrawable(chunk))
+                continue; // nothing to draw, keep it out of the counts
+            if (frustum && !Renderer_chunkInFrustum(chunk, frustum)) {
+                frustum->culled++;
+                continue;
+            }
+            if (frustum && Renderer_chunkHidden(chunk, frustum)) {
+                frustum->occluded++;
+                continue;
+            }
+            if (frustum)
+                frustum->visible++;
+            Renderer_drawChunk(world, chunk, program);
+        }
+    }
+
+     // resident chunks the camera can see; call world.update first to stream around the camera.
+     // extract the frustum once per frame, its visible/culled/occluded counts then cover this pass.
+     // a NULL frustum draws everything. With a ChunkBatch on the world the chunks go out
+     // in one draw call and the program must be using chunk_batch.vert
+     void renderWorld(struct World* world, struct Program* program, struct Frustum* frustum) {
+        struct ChunkBatch* batch = world->state->batch;
+        if (batch)
+            batch->begin(batch);
+        if (!frustum || !Renderer_walkVisible(world, program, frustum))
+            Renderer_drawAll(world, program, frustum);
+        if (batch)
+            batch->flush(batch, program);
+    }
+
+    // queue the solid floor of every meshed chunk as an occluder box for this frame.
+    // boxes are pulled in slightly so a chunk never hides itself
+    #define RENDERER_OCCLUDER_INSET 0.05f
+    void occludeWorld(struct World* world, struct OcclusionCuller* culler) {
+        const float in = RENDERER_OCCLUDER_INSET;
+        for (int i = 0; i < world->loadedCount; i++) {
+            struct Chunk* chunk = &world->loaded[i]->chunk;
+            if (chunk->solidFloor == 0)
+                continue;
+            float x = chunk->position->x * CHUNK_SIZE;
+            float z = chunk->position->y * CHUNK_SIZE;
+            culler->addBox(culler, x + in, 0, z + in,
+                           x + CHUNK_SIZE - in, chunk->solidFloor - in, z + CHUNK_SIZE - in);
+        }
     }
 
     inline static struct Renderer newRenderer() {
@@ -52,6 +217,7 @@
             .render = &render,
             .renderChunk = &renderChunk,
             .renderWorld = &renderWorld,
+            .occludeWorld = &occludeWorld,
         };
     }
 
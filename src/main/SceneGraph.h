@@ -0,0 +1,192 @@
+#ifndef SCENEGRAPH_H_
+#define SCENEGRAPH_H_
+    #include "Vec.h"
+    #include "Matrix4.h"
+    #include "Model.h"
+    #include "Shader.h"
+    #include "Textures.h"
+    #include "Renderer.h"
+    #include "TransformStore.h"
+    #include <stdlib.h>
+    #include <string.h>
+    #include <stdint.h>
+
+    // Parent/child transforms as one flat array. A node can only be added
+    // under a node that already exists, so parents always come before their
+    // children and a single front-to-back pass sees every parent's world
+    // matrix before its children need it.
+    //
+    // Local matrices live in a TransformStore and are rebuilt there in SIMD
+    // batches. update then walks the array once: a node's world matrix is
+    // recomputed only when its own local changed or its parent's world did,
+    // so moving one root touches that root's subtree and nothing else.
+    #define SCENE_NO_PARENT -1
+    #define SCENE_DEFAULT_CAPACITY 64
+
+    struct SceneState {
+        int count, capacity;
+        struct TransformStore locals;   // same index as the node
+        int* parents;                   // SCENE_NO_PARENT for roots
+        struct Mat4* world;
+        uint8_t* changed;               // local changed since the last update
+        struct Model** models;          // NULL = nothing to draw for the node
+        struct Texture** textures;
+        int recomputed;                 // world matrices rebuilt by the last update
+    };
+
+    struct SceneGraph {
+        struct SceneState* state;
+
+        // parent is SCENE_NO_PARENT or an existing node; returns the new node
+        int (*add)(struct SceneGraph* this, int parent, struct Vec3 position, struct Vec3 rotation, struct Vec3 scale);
+        void (*setPosition)(struct SceneGraph* this, int node, struct Vec3 position);
+        void (*setRotation)(struct SceneGraph* this, int node, struct Vec3 rotation);
+        void (*setScale)(struct SceneGraph* this, int node, struct Vec3 scale);
+        // draw model with the node's world matrix; NULL detaches
+        void (*attach)(struct SceneGraph* this, int node, struct Model* model, struct Texture* texture);
+        int (*parent)(struct SceneGraph* this, int node);
+        // rebuild changed locals, then the world matrices below them
+        void (*update)(struct SceneGraph* this);
+        const struct Mat4* (*world)(struct SceneGraph* this, int node);
+        const struct Mat4* (*local)(struct SceneGraph* this, int node);
+        // every node with a model, using the "model" uniform of prog
+        void (*draw)(struct SceneGraph* this, struct Program* prog);
+        void (*destroy)(struct SceneGraph* this);
+    };
+
+    static void SceneGraph_grow(struct SceneState* s, int capacity) {
+        s->parents = (int*)realloc(s->parents, sizeof(int) * capacity);
+        s->world = (struct Mat4*)realloc(s->world, sizeof(struct Mat4) * capacity);
+        s->changed = (uint8_t*)realloc(s->changed, capacity);
+        s->models = (struct Model**)realloc(s->models, sizeof(struct Model*) * capacity);
+        s->textures = (struct Texture**)realloc(s->textures, sizeof(struct Texture*) * capacity);
+        s->capacity = capacity;
+    }
+
+    static int SceneGraph_add(struct SceneGraph* this, int parent, struct Vec3 position, struct Vec3 rotation, struct Vec3 scale) {
+        struct SceneState* s = this->state;
+        if (parent < SCENE_NO_PARENT || parent >= s->count) {
+            fprintf(stderr, "SceneGraph: parent %d does not exist\n", parent);
+            return -1;
+        }
+        if (s->count == s->capacity)
+            SceneGraph_grow(s, s->capacity * 2);
+        int node = s->locals.add(&s->locals, position, rotation, scale);
+        s->count++;
+        s->parents[node] = parent;
+        s->changed[node] = 1;
+        s->models[node] = NULL;
+        s->textures[node] = NULL;
+        return node;
+    }
+
+    static void SceneGraph_setPosition(struct SceneGraph* this, int node, struct Vec3 position) {
+        struct SceneState* s = this->state;
+        s->locals.setPosition(&s->locals, node, position);
+        s->changed[node] = 1;
+    }
+
+    static void SceneGraph_setRotation(struct SceneGraph* this, int node, struct Vec3 rotation) {
+        struct SceneState* s = this->state;
+        s->locals.setRotation(&s->locals, node, rotation);
+        s->changed[node] = 1;
+    }
+
+    static void SceneGraph_setScale(struct SceneGraph* this, int node, struct Vec3 scale) {
+        struct SceneState* s = this->state;
+        s->locals.setScale(&s->locals, node, scale);
+        s->changed[node] = 1;
+    }
+
+    static void SceneGraph_attach(struct SceneGraph* this, int node, struct Model* model, struct Texture* texture) {
+        this->state->models[node] = model;
+        this->state->textures[node] = texture;
+    }
+
+    static int SceneGraph_parent(struct SceneGraph* this, int node) {
+        return this->state->parents[node];
+    }
+
+    // changed[] turns into "world is stale" as it goes: a node is stale
+    // when its local changed or its parent, which came earlier, was stale
+    static void SceneGraph_update(struct SceneGraph* this) {
+        struct SceneState* s = this->state;
+        s->locals.update(&s->locals);
+        s->recomputed = 0;
+        for (int i = 0; i < s->count; i++) {
+            int parent = s->parents[i];
+            if (!s->changed[i] && (parent == SCENE_NO_PARENT || !s->changed[parent]))
+                continue;
+            s->changed[i] = 1;
+            const struct Mat4* local = s->locals.matrix(&s->locals, i);
+            if (parent == SCENE_NO_PARENT)
+                s->world[i] = *local;
+            else
+                mat4_mul(&s->world[i], &s->world[parent], local);
+            s->recomputed++;
+        }
+        memset(s->changed, 0, s->count);
+    }
+
+    static const struct Mat4* SceneGraph_world(struct SceneGraph* this, int node) {
+        return &this->state->world[node];
+    }
+
+    static const struct Mat4* SceneGraph_local(struct SceneGraph* this, int node) {
+        struct SceneState* s = this->state;
+        return s->locals.matrix(&s->locals, node);
+    }
+
+    static void SceneGraph_draw(struct SceneGraph* this, struct Program* prog) {
+        struct SceneState* s = this->state;
+        struct Uniform umodel = Uniform.new(GL_MAT4, prog, "model");
+        for (int i = 0; i < s->count; i++) {
+            if (!s->models[i])
+                continue;
+            umodel.ld(&umodel, (void*)&s->world[i]);
+            render(s->models[i], s->textures[i]);
+        }
+    }
+
+    static void SceneGraph_destroy(struct SceneGraph* this) {
+        struct SceneState* s = this->state;
+        if (!s)
+            return;
+        s->locals.destroy(&s->locals);
+        free(s->parents);
+        free(s->world);
+        free(s->changed);
+        free(s->models);
+        free(s->textures);
+        free(s);
+        this->state = NULL;
+    }
+
+    // pool is handed to the local TransformStore and may be NULL
+    static struct SceneGraph newSceneGraph(int capacity, struct ThreadPool* pool) {
+        struct SceneState* s = (struct SceneState*)calloc(1, sizeof(struct SceneState));
+        if (capacity <= 0)
+            capacity = SCENE_DEFAULT_CAPACITY;
+        s->locals = TransformStore.new(capacity, pool);
+        SceneGraph_grow(s, capacity);
+        return (struct SceneGraph) {
+            .state = s,
+            .add = &SceneGraph_add,
+            .setPosition = &SceneGraph_setPosition,
+            .setRotation = &SceneGraph_setRotation,
+            .setScale = &SceneGraph_setScale,
+            .attach = &SceneGraph_attach,
+            .parent = &SceneGraph_parent,
+            .update = &SceneGraph_update,
+            .world = &SceneGraph_world,
+            .local = &SceneGraph_local,
+            .draw = &SceneGraph_draw,
+            .destroy = &SceneGraph_destroy,
+        };
+    }
+
+    static const struct {
+        struct SceneGraph (*new)(int capacity, struct ThreadPool* pool);
+    } SceneGraph = { .new = &newSceneGraph };
+
+#endif
@@ -125,16 +125,9 @@
     };
     void ldm(struct Uniform* u, void* data) {
         if(u->type == GL_MAT4) {
-            struct Mat4 mat = *(struct Mat4*)data;
-            glUniformMatrix4fv(u->location, 1, GL_TRUE, mat.m);
+            glUniformMatrix4fv(u->location, 1, GL_TRUE, ((struct Mat4*)data)->m);
         } else if(u->type == GL_V3F) {
-            struct Vec3 vec = *(struct Vec3*)data;
-            struct Vector vals = Vector.new(0, FIELD_TYPE_FLOAT);
-            vals.push_back(&vals, &vec.x);
-            vals.push_back(&vals, &vec.y);
-            vals.push_back(&vals, &vec.z);
-            glUniform3fv(u->location, 1, (float*)vals.data);
-            vals.destroy(&vals);
+            glUniform3fv(u->location, 1, &((struct Vec3*)data)->x); // x, y, z are packed
         }
     }
     inline static struct Uniform newUniform(GLuint type, struct Program* program, char* name) {
@@ -151,12 +144,12 @@
     void load_basics(struct Program* prog) {
         struct Mat4 mat = Mat4.new();
         struct Uniform proj = Uniform.new(GL_MAT4, prog, "proj");
-        mat.projection(&mat, 70.0f, 640.0f/480.0f, 0.1f, 1000.0f);
+        mat4_projection(&mat, 70.0f, 640.0f/480.0f, 0.1f, 1000.0f);
 
 
         struct Mat4 mmodel = Mat4.new();
         struct Uniform umodel = Uniform.new(GL_MAT4, prog, "model");
-        mmodel.transform(&mmodel, 0,0,0,0,0,0,1,1,1);
+        mat4_transform(&mmodel, 0,0,0,0,0,0,1,1,1);
 
         
         prog->start(prog);
@@ -168,7 +161,7 @@
     void load_cam(struct Program* prog, struct Vec3*pos, struct Vec3* rot) {
         struct Mat4 view = Mat4.new();
         struct Uniform mview = Uniform.new(GL_MAT4, prog, "view");
-        view.view(&view, pos->x, pos->y, pos->z, rot->x, rot->y, rot->z);
+        mat4_view(&view, pos->x, pos->y, pos->z, rot->x, rot->y, rot->z);
         prog->start(prog);
         mview.ld(&mview, (void*)&view);
         prog->stop();
@@ -0,0 +1,146 @@
+#ifndef THREADPOOL_H_
+#define THREADPOOL_H_
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <pthread.h>
+    #include <unistd.h>
+
+    // Fixed set of worker threads pulling tasks off one FIFO queue. The queue
+    // lives behind a pointer so the pool struct can be passed around by value
+    // like the rest of the wrapper types.
+    struct ThreadPoolTask {
+        void (*run)(void* arg);
+        void* arg;
+        struct ThreadPoolTask* next;
+    };
+
+    struct ThreadPoolState {
+        pthread_t* threads;
+        int threadCount;
+        pthread_mutex_t lock;
+        pthread_cond_t hasWork;
+        pthread_cond_t idle;
+        struct ThreadPoolTask* head;
+        struct ThreadPoolTask* tail;
+        int queued;
+        int running;
+        int stopping;
+    };
+
+    struct ThreadPool {
+        struct ThreadPoolState* state;
+        void (*submit)(struct ThreadPool* this, void (*run)(void* arg), void* arg);
+        void (*wait)(struct ThreadPool* this);
+        int (*pending)(struct ThreadPool* this);
+        void (*destroy)(struct ThreadPool* this);
+    };
+
+    static void* ThreadPool_worker(void* arg) {
+        struct ThreadPoolState* s = (struct ThreadPoolState*)arg;
+        pthread_mutex_lock(&s->lock);
+        for (;;) {
+            while (!s->head && !s->stopping)
+                pthread_cond_wait(&s->hasWork, &s->lock);
+            if (!s->head && s->stopping)
+                break;
+
+            struct ThreadPoolTask* task = s->head;
+            s->head = task->next;
+            if (!s->head) s->tail = NULL;
+            s->queued--;
+            s->running++;
+            pthread_mutex_unlock(&s->lock);
+
+            task->run(task->arg);
+            free(task);
+
+            pthread_mutex_lock(&s->lock);
+            s->running--;
+            if (!s->head && s->running == 0)
+                pthread_cond_broadcast(&s->idle);
+        }
+        pthread_mutex_unlock(&s->lock);
+        return NULL;
+    }
+
+    static void ThreadPool_submit(struct ThreadPool* this, void (*run)(void* arg), void* arg) {
+        struct ThreadPoolState* s = this->state;
+        struct ThreadPoolTask* task = (struct ThreadPoolTask*)malloc(sizeof(struct ThreadPoolTask));
+        task->run = run;
+        task->arg = arg;
+        task->next = NULL;
+
+        pthread_mutex_lock(&s->lock);
+        if (s->tail) s->tail->next = task;
+        else s->head = task;
+        s->tail = task;
+        s->queued++;
+        pthread_cond_signal(&s->hasWork);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    // block until the queue is empty and no task is running
+    static void ThreadPool_wait(struct ThreadPool* this) {
+        struct ThreadPoolState* s = this->state;
+        pthread_mutex_lock(&s->lock);
+        while (s->head || s->running)
+            pthread_cond_wait(&s->idle, &s->lock);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    // tasks queued or running
+    static int ThreadPool_pending(struct ThreadPool* this) {
+        struct ThreadPoolState* s = this->state;
+        pthread_mutex_lock(&s->lock);
+        int n = s->queued + s->running;
+        pthread_mutex_unlock(&s->lock);
+        return n;
+    }
+
+    // finishes every queued task, then joins the workers
+    static void ThreadPool_destroy(struct ThreadPool* this) {
+        struct ThreadPoolState* s = this->state;
+        if (!s) return;
+        pthread_mutex_lock(&s->lock);
+        s->stopping = 1;
+        pthread_cond_broadcast(&s->hasWork);
+        pthread_mutex_unlock(&s->lock);
+        for (int i = 0; i < s->threadCount; i++)
+            pthread_join(s->threads[i], NULL);
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->hasWork);
+        pthread_cond_destroy(&s->idle);
+        free(s->threads);
+        free(s);
+        this->state = NULL;
+    }
+
+    // threadCount <= 0 uses one thread per core minus one for the GL thread
+    static struct ThreadPool newThreadPool(int threadCount) {
+        if (threadCount <= 0) {
+            long cores = sysconf(_SC_NPROCESSORS_ONLN);
+            threadCount = (cores > 1) ? (int)cores - 1 : 1;
+        }
+        struct ThreadPoolState* s = (struct ThreadPoolState*)calloc(1, sizeof(struct ThreadPoolState));
+        s->threadCount = threadCount;
+        s->threads = (pthread_t*)malloc(threadCount * sizeof(pthread_t));
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_cond_init(&s->hasWork, NULL);
+        pthread_cond_init(&s->idle, NULL);
+        for (int i = 0; i < threadCount; i++)
+            pthread_create(&s->threads[i], NULL, &ThreadPool_worker, s);
+
+        return (struct ThreadPool) {
+            .state = s,
+            .submit = &ThreadPool_submit,
+            .wait = &ThreadPool_wait,
+            .pending = &ThreadPool_pending,
+            .destroy = &ThreadPool_destroy,
+        };
+    }
+
+    static const struct {
+        struct ThreadPool (*new)(int threadCount);
+    } ThreadPool = { .new = &newThreadPool };
+
+#endif
@@ -0,0 +1,356 @@
+#ifndef TRANSFORMSTORE_H_
+#define TRANSFORMSTORE_H_
+    #include "Vec.h"
+    #include "Matrix4.h"
+    #include "ThreadPool.h"
+    #include <stdlib.h>
+    #include <string.h>
+    #include <stdint.h>
+    #include <pthread.h>
+
+    // define TRANSFORM_NO_SIMD to force the scalar rebuild
+    #if !defined(TRANSFORM_NO_SIMD) && defined(__SSE2__)
+    #include <emmintrin.h>
+    #define TRANSFORM_SSE2 1
+    #endif
+
+    // Positions, rotations and scales of many objects, one array per
+    // component. Rotations are in degrees and compose like mat4_transform.
+    // Setters only mark an object dirty. update rebuilds the world matrices
+    // of dirty objects four at a time (one object per SSE lane), split over
+    // a thread pool when there are enough of them. Draw code then reads the
+    // finished matrices instead of building one per draw.
+    #define TRANSFORM_LANES 4
+    #define TRANSFORM_JOB_WORDS 64    // dirty words (32 objects each) per pool job
+    #define TRANSFORM_DEFAULT_CAPACITY 64
+
+    struct TransformState;
+
+    struct TransformJob {
+        struct TransformState* state;
+        int firstWord, endWord;
+    };
+
+    struct TransformState {
+        int count, capacity;            // capacity stays a multiple of TRANSFORM_LANES
+        float* block;                   // all nine component arrays in one allocation
+        float *px, *py, *pz;
+        float *rx, *ry, *rz;
+        float *sx, *sy, *sz;
+        struct Mat4* world;
+        uint32_t* dirty;                // one bit per object
+        int anyDirty;
+        int rebuilt;                    // objects rebuilt by the last update, in whole lanes
+
+        struct ThreadPool* pool;        // NULL = rebuild on the calling thread only
+        struct TransformJob* jobs;
+        int jobCapacity;
+        pthread_mutex_t lock;
+        pthread_cond_t done;
+        int pendingJobs;
+    };
+
+    struct TransformStore {
+        struct TransformState* state;
+
+        // returns the object's index, stable for the store's lifetime
+        int (*add)(struct TransformStore* this, struct Vec3 position, struct Vec3 rotation, struct Vec3 scale);
+        void (*setPosition)(struct TransformStore* this, int id, struct Vec3 position);
+        void (*setRotation)(struct TransformStore* this, int id, struct Vec3 rotation);
+        void (*setScale)(struct TransformStore* this, int id, struct Vec3 scale);
+        struct Vec3 (*position)(struct TransformStore* this, int id);
+        struct Vec3 (*rotation)(struct TransformStore* this, int id);
+        struct Vec3 (*scale)(struct TransformStore* this, int id);
+        // rebuild dirty world matrices; once per frame before drawing
+        void (*update)(struct TransformStore* this);
+        // world matrix as of the last update
+        const struct Mat4* (*matrix)(struct TransformStore* this, int id);
+        int (*count)(struct TransformStore* this);
+        void (*destroy)(struct TransformStore* this);
+    };
+
+    static inline void TransformStore_markDirty(struct TransformState* s, int id) {
+        s->dirty[id >> 5] |= 1u << (id & 31);
+        s->anyDirty = 1;
+    }
+
+    // the nine arrays are carved out of one 16 byte aligned block so the
+    // lanes load straight from them
+    static void TransformStore_grow(struct TransformState* s, int capacity) {
+        capacity = (capacity + TRANSFORM_LANES - 1) & ~(TRANSFORM_LANES - 1);
+        float* block = NULL;
+        if (posix_memalign((void**)&block, 16, sizeof(float) * 9 * capacity) != 0) {
+            fprintf(stderr, "TransformStore: out of memory for %d transforms\n", capacity);
+            exit(1);
+        }
+        float** fields[9] = { &s->px, &s->py, &s->pz, &s->rx, &s->ry, &s->rz, &s->sx, &s->sy, &s->sz };
+        for (int f = 0; f < 9; f++) {
+            float* dst = block + f * capacity;
+            if (s->count)
+                memcpy(dst, *fields[f], sizeof(float) * s->count);
+            // unused lanes are identity transforms, so whole groups can be rebuilt
+            float fill = f >= 6 ? 1.0f : 0.0f;
+            for (int i = s->count; i < capacity; i++)
+                dst[i] = fill;
+            *fields[f] = dst;
+        }
+        free(s->block);
+        s->block = block;
+
+        struct Mat4* world = NULL;
+        if (posix_memalign((void**)&world, 16, sizeof(struct Mat4) * capacity) != 0) {
+            fprintf(stderr, "TransformStore: out of memory for %d transforms\n", capacity);
+            exit(1);
+        }
+        if (s->count)
+            memcpy(world, s->world, sizeof(struct Mat4) * s->count);
+        free(s->world);
+        s->world = world;
+
+        int words = (capacity + 31) / 32;
+        s->dirty = (uint32_t*)realloc(s->dirty, sizeof(uint32_t) * words);
+        int oldWords = (s->capacity + 31) / 32;
+        memset(s->dirty + oldWords, 0, sizeof(uint32_t) * (words - oldWords));
+        s->capacity = capacity;
+    }
+
+    static int TransformStore_add(struct TransformStore* this, struct Vec3 position, struct Vec3 rotation, struct Vec3 scale) {
+        struct TransformState* s = this->state;
+        if (s->count == s->capacity)
+            TransformStore_grow(s, s->capacity * 2);
+        int id = s->count++;
+        s->px[id] = position.x; s->py[id] = position.y; s->pz[id] = position.z;
+        s->rx[id] = rotation.x; s->ry[id] = rotation.y; s->rz[id] = rotation.z;
+        s->sx[id] = scale.x;    s->sy[id] = scale.y;    s->sz[id] = scale.z;
+        TransformStore_markDirty(s, id);
+        return id;
+    }
+
+    static void TransformStore_setPosition(struct TransformStore* this, int id, struct Vec3 position) {
+        struct TransformState* s = this->state;
+        s->px[id] = position.x; s->py[id] = position.y; s->pz[id] = position.z;
+        TransformStore_markDirty(s, id);
+    }
+
+    static void TransformStore_setRotation(struct TransformStore* this, int id, struct Vec3 rotation) {
+        struct TransformState* s = this->state;
+        s->rx[id] = rotation.x; s->ry[id] = rotation.y; s->rz[id] = rotation.z;
+        TransformStore_markDirty(s, id);
+    }
+
+    static void TransformStore_setScale(struct TransformStore* this, int id, struct Vec3 scale) {
+        struct TransformState* s = this->state;
+        s->sx[id] = scale.x; s->sy[id] = scale.y; s->sz[id] = scale.z;
+        TransformStore_markDirty(s, id);
+    }
+
+    static struct Vec3 TransformStore_position(struct TransformStore* this, int id) {
+        struct TransformState* s = this->state;
+        return newVec3(s->px[id], s->py[id], s->pz[id]);
+    }
+
+    static struct Vec3 TransformStore_rotation(struct TransformStore* this, int id) {
+        struct TransformState* s = this->state;
+        return newVec3(s->rx[id], s->ry[id], s->rz[id]);
+    }
+
+    static struct Vec3 TransformStore_scale(struct TransformStore* this, int id) {
+        struct TransformState* s = this->state;
+        return newVec3(s->sx[id], s->sy[id], s->sz[id]);
+    }
+
+#ifdef TRANSFORM_SSE2
+    // sine and cosine of four angles in degrees. The angle is reduced to
+    // [-pi/4, pi/4] around the nearest multiple of pi/2 (pi/2 split in three
+    // parts to keep the reduction exact), then the cephes sinf/cosf
+    // polynomials; the quadrant swaps and negates the results
+    static inline void Transform_sincos(__m128 degrees, __m128* sinOut, __m128* cosOut) {
+        __m128 x = _mm_mul_ps(degrees, _mm_set1_ps((float)M_PI / 180.0f));
+        __m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps((float)(2.0 / M_PI))));
+        __m128 qf = _mm_cvtepi32_ps(q);
+        x = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(1.5703125f)));
+        x = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(4.837512969970703125e-4f)));
+        x = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(7.54978995489188216e-8f)));
+
+        __m128 x2 = _mm_mul_ps(x, x);
+        __m128 sp = _mm_set1_ps(-1.9515295891e-4f);
+        sp = _mm_add_ps(_mm_mul_ps(sp, x2), _mm_set1_ps(8.3321608736e-3f));
+        sp = _mm_add_ps(_mm_mul_ps(sp, x2), _mm_set1_ps(-1.6666654611e-1f));
+        sp = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(sp, x2), x), x);
+        __m128 cp = _mm_set1_ps(2.443315711809948e-5f);
+        cp = _mm_add_ps(_mm_mul_ps(cp, x2), _mm_set1_ps(-1.388731625493765e-3f));
+        cp = _mm_add_ps(_mm_mul_ps(cp, x2), _mm_set1_ps(4.166664568298827e-2f));
+        cp = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(cp, x2), x2), _mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(x2, _mm_set1_ps(0.5f))));
+
+        // odd quadrants swap sine and cosine
+        __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, _mm_set1_epi32(1)), _mm_set1_epi32(1)));
+        __m128 s = _mm_or_ps(_mm_and_ps(swap, cp), _mm_andnot_ps(swap, sp));
+        __m128 c = _mm_or_ps(_mm_and_ps(swap, sp), _mm_andnot_ps(swap, cp));
+        // sine is negative in quadrants 2 and 3, cosine in 1 and 2
+        __m128 sinSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, _mm_set1_epi32(2)), 30));
+        __m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, _mm_set1_epi32(1)), _mm_set1_epi32(2)), 30));
+        *sinOut = _mm_xor_ps(s, sinSign);
+        *cosOut = _mm_xor_ps(c, cosSign);
+    }
+
+    // objects first..first+3 in one pass: mat4_eulerXYZ and mat4_transform
+    // on four lanes, then each row block transposed into the four matrices
+    static inline void Transform_rebuildGroup(struct TransformState* s, int first) {
+        __m128 sinX, cosX, sinY, cosY, sinZ, cosZ;
+        Transform_sincos(_mm_load_ps(s->rx + first), &sinX, &cosX);
+        Transform_sincos(_mm_load_ps(s->ry + first), &sinY, &cosY);
+        Transform_sincos(_mm_load_ps(s->rz + first), &sinZ, &cosZ);
+        __m128 kx = _mm_load_ps(s->sx + first);
+        __m128 ky = _mm_load_ps(s->sy + first);
+        __m128 kz = _mm_load_ps(s->sz + first);
+
+        __m128 sxsy = _mm_mul_ps(sinX, sinY);
+        __m128 cxsy = _mm_mul_ps(cosX, sinY);
+        __m128 row[3][4];
+        row[0][0] = _mm_mul_ps(_mm_mul_ps(cosY, cosZ), kx);
+        row[0][1] = _mm_mul_ps(_mm_mul_ps(cosY, sinZ), ky);
+        row[0][2] = _mm_mul_ps(_mm_sub_ps(_mm_setzero_ps(), sinY), kz);
+        row[0][3] = _mm_load_ps(s->px + first);
+        row[1][0] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(sxsy, cosZ), _mm_mul_ps(cosX, sinZ)), kx);
+        row[1][1] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(sxsy, sinZ), _mm_mul_ps(cosX, cosZ)), ky);
+        row[1][2] = _mm_mul_ps(_mm_mul_ps(sinX, cosY), kz);
+        row[1][3] = _mm_load_ps(s->py + first);
+        row[2][0] = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(cxsy, cosZ), _mm_mul_ps(sinX, sinZ)), kx);
+        row[2][1] = _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(cxsy, sinZ), _mm_mul_ps(sinX, cosZ)), ky);
+        row[2][2] = _mm_mul_ps(_mm_mul_ps(cosX, cosY), kz);
+        row[2][3] = _mm_load_ps(s->pz + first);
+
+        const __m128 last = _mm_setr_ps(0, 0, 0, 1);
+        for (int r = 0; r < 3; r++) {
+            _MM_TRANSPOSE4_PS(row[r][0], row[r][1], row[r][2], row[r][3]);
+            for (int lane = 0; lane < 4; lane++)
+                _mm_store_ps(s->world[first + lane].m + r*4, row[r][lane]);
+        }
+        for (int lane = 0; lane < 4; lane++)
+            _mm_store_ps(s->world[first + lane].m + 12, last);
+    }
+#else
+    static inline void Transform_rebuildGroup(struct TransformState* s, int first) {
+        for (int i = first; i < first + TRANSFORM_LANES; i++)
+            mat4_transform(&s->world[i], s->px[i], s->py[i], s->pz[i],
+                           s->rx[i], s->ry[i], s->rz[i], s->sx[i], s->sy[i], s->sz[i]);
+    }
+#endif
+
+    // rebuilds every group of four with a dirty bit in words [firstWord, endWord)
+    // and clears those bits; returns the number of groups rebuilt
+    static int TransformStore_rebuildWords(struct TransformState* s, int firstWord, int endWord) {
+        int groups = 0;
+        for (int w = firstWord; w < endWord; w++) {
+            uint32_t bits = s->dirty[w];
+            if (!bits)
+                continue;
+            for (int g = 0; g < 32 / TRANSFORM_LANES; g++) {
+                if (!((bits >> (g * TRANSFORM_LANES)) & ((1u << TRANSFORM_LANES) - 1)))
+                    continue;
+                int first = w * 32 + g * TRANSFORM_LANES;
+                if (first >= s->count)
+                    break;
+                Transform_rebuildGroup(s, first);
+                groups++;
+            }
+            s->dirty[w] = 0;
+        }
+        return groups;
+    }
+
+    static void TransformStore_job(void* arg) {
+        struct TransformJob* job = (struct TransformJob*)arg;
+        struct TransformState* s = job->state;
+        int groups = TransformStore_rebuildWords(s, job->firstWord, job->endWord);
+        pthread_mutex_lock(&s->lock);
+        s->rebuilt += groups * TRANSFORM_LANES;
+        if (--s->pendingJobs == 0)
+            pthread_cond_broadcast(&s->done);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    // jobs own disjoint word ranges, so no two threads write the same
+    // matrix or dirty word. The calling thread takes the first range and
+    // then waits for the rest; pool->wait is not used since the pool may
+    // be busy with unrelated work
+    static void TransformStore_update(struct TransformStore* this) {
+        struct TransformState* s = this->state;
+        s->rebuilt = 0;
+        if (!s->anyDirty)
+            return;
+        s->anyDirty = 0;
+        int words = (s->count + 31) / 32;
+        int jobCount = (words + TRANSFORM_JOB_WORDS - 1) / TRANSFORM_JOB_WORDS;
+        if (!s->pool || jobCount < 2) {
+            s->rebuilt = TransformStore_rebuildWords(s, 0, words) * TRANSFORM_LANES;
+            return;
+        }
+        if (jobCount > s->jobCapacity) {
+            s->jobs = (struct TransformJob*)realloc(s->jobs, sizeof(struct TransformJob) * jobCount);
+            s->jobCapacity = jobCount;
+        }
+        s->pendingJobs = jobCount - 1;
+        for (int j = 1; j < jobCount; j++) {
+            int first = j * TRANSFORM_JOB_WORDS;
+            s->jobs[j] = (struct TransformJob){ s, first, first + TRANSFORM_JOB_WORDS < words ? first + TRANSFORM_JOB_WORDS : words };
+            s->pool->submit(s->pool, &TransformStore_job, &s->jobs[j]);
+        }
+        int groups = TransformStore_rebuildWords(s, 0, TRANSFORM_JOB_WORDS);
+        pthread_mutex_lock(&s->lock);
+        s->rebuilt += groups * TRANSFORM_LANES;
+        while (s->pendingJobs > 0)
+            pthread_cond_wait(&s->done, &s->lock);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    static const struct Mat4* TransformStore_matrix(struct TransformStore* this, int id) {
+        return &this->state->world[id];
+    }
+
+    static int TransformStore_count(struct TransformStore* this) {
+        return this->state->count;
+    }
+
+    static void TransformStore_destroy(struct TransformStore* this) {
+        struct TransformState* s = this->state;
+        if (!s)
+            return;
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->done);
+        free(s->block);
+        free(s->world);
+        free(s->dirty);
+        free(s->jobs);
+        free(s);
+        this->state = NULL;
+    }
+
+    // pool may be NULL; with one, large updates are split across its workers
+    static struct TransformStore newTransformStore(int capacity, struct ThreadPool* pool) {
+        struct TransformState* s = (struct TransformState*)calloc(1, sizeof(struct TransformState));
+        s->pool = pool;
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_cond_init(&s->done, NULL);
+        TransformStore_grow(s, capacity > 0 ? capacity : TRANSFORM_DEFAULT_CAPACITY);
+        return (struct TransformStore) {
+            .state = s,
+            .add = &TransformStore_add,
+            .setPosition = &TransformStore_setPosition,
+            .setRotation = &TransformStore_setRotation,
+            .setScale = &TransformStore_setScale,
+            .position = &TransformStore_position,
+            .rotation = &TransformStore_rotation,
+            .scale = &TransformStore_scale,
+            .update = &TransformStore_update,
+            .matrix = &TransformStore_matrix,
+            .count = &TransformStore_count,
+            .destroy = &TransformStore_destroy,
+        };
+    }
+
+    static const struct {
+        struct TransformStore (*new)(int capacity, struct ThreadPool* pool);
+    } TransformStore = { .new = &newTransformStore };
+
+#endif
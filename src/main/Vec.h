@@ -1,12 +1,13 @@
 #ifndef VEC_H_
 #define VEC_H_
     #include <stdio.h>
+    // plain floats, so arrays of them are tightly packed and go to GL as they are
     struct Vec3 {
         float x, y, z;
-        float (*getX)(struct Vec3* this);
-        float (*getY)(struct Vec3* this);
-        float (*getZ)(struct Vec3* this);
     };
+    _Static_assert(sizeof(struct Vec3) == 3 * sizeof(float), "Vec3 must stay three packed floats");
+
+    // kept for code written against the old getter members, see Vec3.getX
     float getX(struct Vec3* this) {
         return this->x;
     }
@@ -17,25 +18,35 @@
         return this->z;
     }
 
-    static struct Vec3 newVec3(float x, float y, float z) {
-        return (struct Vec3) {
-            .x = x,
-            .y = y,
-            .z = z,
-            .getX = &getX,
-            .getY = &getY,
-            .getZ = &getZ,
-        };
+    static inline struct Vec3 newVec3(float x, float y, float z) {
+        return (struct Vec3) { .x = x, .y = y, .z = z };
+    }
+    static inline struct Vec3 vec3_add(struct Vec3 a, struct Vec3 b) {
+        return newVec3(a.x + b.x, a.y + b.y, a.z + b.z);
+    }
+    static inline struct Vec3 vec3_sub(struct Vec3 a, struct Vec3 b) {
+        return newVec3(a.x - b.x, a.y - b.y, a.z - b.z);
+    }
+    static inline struct Vec3 vec3_scale(struct Vec3 a, float s) {
+        return newVec3(a.x * s, a.y * s, a.z * s);
+    }
+    static inline float vec3_dot(struct Vec3 a, struct Vec3 b) {
+        return a.x * b.x + a.y * b.y + a.z * b.z;
+    }
+    static inline struct Vec3 vec3_cross(struct Vec3 a, struct Vec3 b) {
+        return newVec3(a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x);
     }
     static const struct {
         struct Vec3 (*new)(float x, float y, float z);
-    } Vec3 = {.new = &newVec3};
+        float (*getX)(struct Vec3* this);
+        float (*getY)(struct Vec3* this);
+        float (*getZ)(struct Vec3* this);
+    } Vec3 = {.new = &newVec3, .getX = &getX, .getY = &getY, .getZ = &getZ};
 
     struct Vec2 {
         float x, y;
-        float (*getX)(struct Vec2* this);
-        float (*getY)(struct Vec2* this);
     };
+    _Static_assert(sizeof(struct Vec2) == 2 * sizeof(float), "Vec2 must stay two packed floats");
 
     float getX2(struct Vec2* this) {
         return this->x;
@@ -44,16 +55,13 @@
         return this->y;
     }
 
-    static struct Vec2 newVec2(float x, float y) {
-        return (struct Vec2) {
-            .x = x,
-            .y = y,
-            .getX = &getX2,
-            .getY = &getY2,
-        };
+    static inline struct Vec2 newVec2(float x, float y) {
+        return (struct Vec2) { .x = x, .y = y };
     }
     static const struct {
         struct Vec2 (*new)(float x, float y);
-    } Vec2 = {.new = &newVec2};
+        float (*getX)(struct Vec2* this);
+        float (*getY)(struct Vec2* this);
+    } Vec2 = {.new = &newVec2, .getX = &getX2, .getY = &getY2};
 
-#endif
\ No newline at end of file
+#endif
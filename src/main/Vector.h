@@ -27,6 +27,7 @@
         FIELD_TYPE_UINT,
         FIELD_TYPE_VEC3,
         FIELD_TYPE_VEC2,
+        FIELD_TYPE_STRUCT, // any fixed size element, see Vector.sized
     } field_type;
 
     struct Vector {
@@ -78,6 +79,7 @@
             case FIELD_TYPE_INT: return sizeof(int);
             case FIELD_TYPE_FLOAT: return sizeof(float);
             case FIELD_TYPE_BYTE: return sizeof(unsigned char);
+            case FIELD_TYPE_UINT: return sizeof(unsigned int);
             case FIELD_TYPE_VEC3: return sizeof(struct Vec3);
             case FIELD_TYPE_VEC2: return sizeof(struct Vec2);
             case FIELD_TYPE_KEY: return sizeof(struct EKey);
@@ -114,8 +116,18 @@
     }
 
 
+    // elements of a caller defined struct, e.g. interleaved vertices
+    static struct Vector newArrSized(int cap, size_t elem_size) {
+        struct Vector v = newArr(0, FIELD_TYPE_STRUCT);
+        v.elem_size = elem_size;
+        v.data = (cap > 0) ? malloc(elem_size * cap) : NULL;
+        v.capacity = cap;
+        return v;
+    }
+
     static const struct {
         struct Vector (*new)(int cap, field_type type);
-    } Vector = { .new = &newArr };
+        struct Vector (*sized)(int cap, size_t elem_size);
+    } Vector = { .new = &newArr, .sized = &newArrSized };
 
 #endif
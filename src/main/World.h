@@ -0,0 +1,580 @@
+#ifndef WORLD_H_
+#define WORLD_H_
+    #include "Chunk.h"
+    #include "Camera.h"
+    #include "ThreadPool.h"
+    #include "Region.h"
+    #include "ChunkBatch.h"
+    #include "Vec.h"
+    #include <stdio.h>
+    #include <stdlib.h>
+    #include <math.h>
+    #include <pthread.h>
+    #define GLFW_INCLUDE_NONE
+    #include <GLFW/glfw3.h>
+    #include <glad.h>
+
+    // An unbounded world streamed around the camera. Chunks live in a hash
+    // map keyed by integer chunk coordinates; only those within `radius`
+    // chunks of the camera are resident, so memory and frame time follow
+    // the view distance, not the size of the world.
+    //
+    // Each chunk goes through three stages:
+    //   generate  worker pool
+    //   mesh      worker pool, from a snapshot taken on the main thread
+    //   upload    GL thread, World.upload under a per-frame time budget
+    // World.update (main thread) does everything else: it retires finished
+    // generate jobs, links each generated chunk to its generated neighbors,
+    // sends dirty chunks to the mesher, unloads chunks that fell out of
+    // range and queues the missing ones nearest the camera first, favoring
+    // the direction it looks in. A chunk is only linked once its blocks are
+    // final, so the mesher never reads a border that is still being written.
+    // With a RegionStore attached, the generate stage loads saved chunks
+    // instead of running the generator, and chunks with unsaved changes are
+    // written out when they unload. With a ChunkBatch attached, meshes are
+    // uploaded into its shared arena instead of a model per chunk.
+    enum {
+        WORLD_STAGE_GENERATE,
+        WORLD_STAGE_MESH,
+        WORLD_STAGE_UPLOAD,
+        WORLD_STAGE_COUNT
+    };
+
+    struct WorldStageStats {
+        int done;           // chunks through this stage
+        double busySeconds; // time spent in the stage, summed over threads
+        double start, end;  // first job started, last job finished
+    };
+
+    // chunks per second over the stage's wall-clock span
+    static inline double WorldStageStats_rate(const struct WorldStageStats* s) {
+        double span = s->end - s->start;
+        return (s->done > 0 && span > 0.0) ? s->done / span : 0.0;
+    }
+
+    struct WorldState;
+
+    struct WorldChunk {
+        struct Chunk chunk;
+        struct Vec2 position;   // chunk.position points here
+        struct WorldState* state;
+        int cx, cz;
+        int generated;          // blocks are final, the chunk may be linked and meshed
+        int busy;               // jobs in flight that point at this node
+        int unloading;          // out of the map, freed once busy drops to 0
+        int slot;               // index in World.loaded
+        unsigned int visitFrame; // World.visitFrame when renderWorld last reached it
+        struct WorldChunk* nextInBucket;
+        struct WorldChunk* nextDone;
+    };
+
+    struct WorldMeshJob {
+        struct WorldChunk* node;
+        unsigned int request;   // chunk.meshRequest when submitted
+        struct ChunkMeshSource source;
+        struct ChunkMeshData result;
+        struct WorldMeshJob* next;
+    };
+
+    struct WorldState {
+        struct ThreadPool pool;
+        int ownsPool;
+        struct WorldGenerator* generator;
+        struct RegionStore* store;         // NULL = nothing persists
+        struct ChunkBatch* batch;          // NULL = a Model per chunk
+        pthread_mutex_t lock;
+        pthread_cond_t drained;
+        int working;                       // jobs still on the workers
+        int inFlight;                      // jobs submitted, not retired on the main thread
+        int generating;                    // generate jobs submitted, not retired
+        struct WorldChunk* generatedHead;  // generate jobs done
+        struct WorldMeshJob* meshedHead;   // mesh jobs done, waiting for upload
+        struct WorldMeshJob* meshedTail;
+        struct WorldStageStats stages[WORLD_STAGE_COUNT];
+        struct RendererVisit* visitQueue;  // Renderer's visibility walk, kept across frames
+        int visitCapacity;
+    };
+
+    struct World {
+        int radius;             // view distance in chunks
+        int maxGenerating;      // generate jobs in flight at once
+        struct WorldChunk** loaded;
+        int loadedCount;
+        int loadedCapacity;
+        struct WorldChunk** buckets;
+        int bucketCount;        // power of two
+        int centerX, centerZ;   // camera chunk at the last update
+        int complete;           // nothing left to load around center
+        unsigned int visitFrame; // bumped per Renderer.renderWorld visibility walk
+        struct WorldState* state;
+        void (*update)(struct World* this, struct Camera* camera);
+        int (*upload)(struct World* this, double budgetSeconds);
+        void (*wait)(struct World* this);
+        int (*pending)(struct World* this);
+        struct WorldStageStats (*stats)(struct World* this, int stage);
+        void (*setStore)(struct World* this, struct RegionStore* store);
+        void (*setBatch)(struct World* this, struct ChunkBatch* batch);
+        int (*save)(struct World* this);
+        void (*destroy)(struct World* this);
+    };
+
+    static inline unsigned int World_hash(int cx, int cz) {
+        return (unsigned int)cx * 73856093u ^ (unsigned int)cz * 19349663u;
+    }
+
+    static struct WorldChunk* World_findNode(struct World* world, int cx, int cz) {
+        struct WorldChunk* node = world->buckets[World_hash(cx, cz) & (world->bucketCount - 1)];
+        while (node && (node->cx != cx || node->cz != cz))
+            node = node->nextInBucket;
+        return node;
+    }
+
+    // loaded chunk at chunk coordinates, NULL when it is not resident
+    static inline struct Chunk* World_getChunk(struct World* world, int x, int z) {
+        struct WorldChunk* node = World_findNode(world, x, z);
+        return node ? &node->chunk : NULL;
+    }
+
+    static void World_insertNode(struct World* world, struct WorldChunk* node) {
+        if (world->loadedCount == world->bucketCount) {
+            int count = world->bucketCount * 2;
+            struct WorldChunk** buckets = (struct WorldChunk**)calloc(count, sizeof(struct WorldChunk*));
+            for (int i = 0; i < world->loadedCount; i++) {
+                struct WorldChunk* n = world->loaded[i];
+                unsigned int b = World_hash(n->cx, n->cz) & (count - 1);
+                n->nextInBucket = buckets[b];
+                buckets[b] = n;
+            }
+            free(world->buckets);
+            world->buckets = buckets;
+            world->bucketCount = count;
+        }
+        unsigned int b = World_hash(node->cx, node->cz) & (world->bucketCount - 1);
+        node->nextInBucket = world->buckets[b];
+        world->buckets[b] = node;
+
+        if (world->loadedCount == world->loadedCapacity) {
+            world->loadedCapacity *= 2;
+            world->loaded = (struct WorldChunk**)realloc(world->loaded, world->loadedCapacity * sizeof(struct WorldChunk*));
+        }
+        node->slot = world->loadedCount;
+        world->loaded[world->loadedCount++] = node;
+    }
+
+    static void World_removeNode(struct World* world, struct WorldChunk* node) {
+        struct WorldChunk** link = &world->buckets[World_hash(node->cx, node->cz) & (world->bucketCount - 1)];
+        while (*link != node)
+            link = &(*link)->nextInBucket;
+        *link = node->nextInBucket;
+
+        struct WorldChunk* last = world->loaded[--world->loadedCount];
+        last->slot = node->slot;
+        world->loaded[node->slot] = last;
+    }
+
+    static void World_recordStage(struct WorldState* s, int stage, double start, double end) {
+        struct WorldStageStats* st = &s->stages[stage];
+        if (st->done == 0 || start < st->start) st->start = start;
+        if (end > st->end) st->end = end;
+        st->busySeconds += end - start;
+        st->done++;
+    }
+
+    static void World_finishJob(struct WorldState* s) {
+        if (--s->working == 0)
+            pthread_cond_broadcast(&s->drained);
+    }
+
+    static void World_generateJob(void* arg) {
+        struct WorldChunk* node = (struct WorldChunk*)arg;
+        struct WorldState* s = node->state;
+        double start = glfwGetTime();
+        if (!s->store || !s->store->load(s->store, &node->chunk, node->cx, node->cz)) {
+            s->generator->generate(s->generator, &node->chunk);
+            node->chunk.unsaved = 1; // saving it spares the generator next time
+        }
+        double end = glfwGetTime();
+
+        pthread_mutex_lock(&s->lock);
+        World_recordStage(s, WORLD_STAGE_GENERATE, start, end);
+        node->nextDone = s->generatedHead;
+        s->generatedHead = node;
+        World_finishJob(s);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    static void World_meshJob(void* arg) {
+        struct WorldMeshJob* job = (struct WorldMeshJob*)arg;
+        struct WorldState* s = job->node->state;
+        double start = glfwGetTime();
+        Chunk_buildMesh(&job->source, job->node->chunk.meshMode, &job->result);
+        double end = glfwGetTime();
+
+        pthread_mutex_lock(&s->lock);
+        World_recordStage(s, WORLD_STAGE_MESH, start, end);
+        job->next = NULL;
+        if (s->meshedTail) s->meshedTail->next = job;
+        else s->meshedHead = job;
+        s->meshedTail = job;
+        World_finishJob(s);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    static void World_submit(struct WorldState* s, void (*run)(void* arg), void* arg) {
+        pthread_mutex_lock(&s->lock);
+        s->working++;
+        s->inFlight++;
+        pthread_mutex_unlock(&s->lock);
+        s->pool.submit(&s->pool, run, arg);
+    }
+
+    static void World_freeNode(struct WorldChunk* node) {
+        Chunk_releaseBlocks(&node->chunk);
+        free(node);
+    }
+
+    // a job that pointed at node was retired on the main thread
+    static void World_retire(struct WorldState* s, struct WorldChunk* node) {
+        node->busy--;
+        pthread_mutex_lock(&s->lock);
+        s->inFlight--;
+        pthread_mutex_unlock(&s->lock);
+        if (node->unloading && node->busy == 0)
+            World_freeNode(node);
+    }
+
+    static void World_submitMesh(struct World* this, struct WorldChunk* node) {
+        struct Chunk* chunk = &node->chunk;
+        chunk->dirty = 0;
+        chunk->meshRequest++; // results still in flight are dropped
+        if (Chunk_skipsMeshing(chunk)) {
+            Chunk_clearMesh(chunk);
+            if (this->state->batch) // give its arena pages back too
+                this->state->batch->release(this->state->batch, chunk);
+            return;
+        }
+        struct WorldMeshJob* job = (struct WorldMeshJob*)malloc(sizeof(struct WorldMeshJob));
+        job->node = node;
+        job->request = chunk->meshRequest;
+        Chunk_snapshot(chunk, &job->source);
+        node->busy++;
+        World_submit(this->state, &World_meshJob, job);
+    }
+
+    // drop a chunk that left the view; its memory goes once no job uses it
+    static void World_unload(struct World* this, struct WorldChunk* node) {
+        struct RegionStore* store = this->state->store;
+        if (store && node->generated)
+            store->save(store, &node->chunk, node->cx, node->cz);
+        World_removeNode(this, node);
+        if (node->generated)
+            Chunk_unlinkNeighbors(&node->chunk); // neighbors get their border faces back
+        Chunk_dequeueDirty(&node->chunk);
+        node->chunk.mesh.unloadPacked(&node->chunk.mesh);
+        if (this->state->batch)
+            this->state->batch->release(this->state->batch, &node->chunk);
+        node->unloading = 1;
+        if (node->busy == 0)
+            World_freeNode(node);
+    }
+
+    static void World_load(struct World* this, int cx, int cz) {
+        struct WorldChunk* node = (struct WorldChunk*)calloc(1, sizeof(struct WorldChunk));
+        node->cx = cx;
+        node->cz = cz;
+        node->state = this->state;
+        node->position = Vec2.new(cx, cz);
+        node->chunk = Chunk.new(&node->position);
+        node->chunk.owner = node;
+        node->busy = 1;
+        World_insertNode(this, node);
+        this->state->generating++;
+        World_submit(this->state, &World_generateJob, node);
+    }
+
+    static int World_neighborsReady(struct World* this, struct WorldChunk* node, int centerX, int centerZ) {
+        static const int OFFSETS[4][2] = {{0, 1}, {0, -1}, {-1, 0}, {1, 0}};
+        for (int i = 0; i < 4; i++) {
+            int cx = node->cx + OFFSETS[i][0], cz = node->cz + OFFSETS[i][1];
+            int dx = cx - centerX, dz = cz - centerZ;
+            if (dx * dx + dz * dz > this->radius * this->radius)
+                continue; // never loaded from here
+            struct WorldChunk* n = World_findNode(this, cx, cz);
+            if (!n || !n->generated)
+                return 0;
+        }
+        return 1;
+    }
+
+    struct WorldLoadCandidate {
+        int cx, cz;
+        float score;
+    };
+
+    static int World_compareCandidates(const void* a, const void* b) {
+        float sa = ((const struct WorldLoadCandidate*)a)->score;
+        float sb = ((const struct WorldLoadCandidate*)b)->score;
+        return (sa > sb) - (sa < sb);
+    }
+
+    static void World_update(struct World* this, struct Camera* camera) {
+        struct WorldState* s = this->state;
+        int r = this->radius;
+        int centerX = (int)floorf(camera->position.x / CHUNK_SIZE);
+        int centerZ = (int)floorf(camera->position.z / CHUNK_SIZE);
+        // horizontal view direction, as in Camera_moveForward
+        float forwardX = -sinf(rad(camera->rotation.y));
+        float forwardZ = -cosf(rad(camera->rotation.y));
+
+        // finished generate jobs: link to generated neighbors and queue a mesh
+        pthread_mutex_lock(&s->lock);
+        struct WorldChunk* done = s->generatedHead;
+        s->generatedHead = NULL;
+        pthread_mutex_unlock(&s->lock);
+        while (done) {
+            struct WorldChunk* node = done;
+            done = node->nextDone;
+            s->generating--;
+            if (!node->unloading) {
+                node->generated = 1;
+                struct WorldChunk* n;
+                if ((n = World_findNode(this, node->cx, node->cz + 1)) && n->generated) Chunk_setNeighbor(&node->chunk, 0, &n->chunk); // FRONT
+                if ((n = World_findNode(this, node->cx, node->cz - 1)) && n->generated) Chunk_setNeighbor(&node->chunk, 1, &n->chunk); // BACK
+                if ((n = World_findNode(this, node->cx - 1, node->cz)) && n->generated) Chunk_setNeighbor(&node->chunk, 2, &n->chunk); // LEFT
+                if ((n = World_findNode(this, node->cx + 1, node->cz)) && n->generated) Chunk_setNeighbor(&node->chunk, 3, &n->chunk); // RIGHT
+                Chunk_markDirty(&node->chunk);
+            }
+            World_retire(s, node);
+        }
+
+        // out of range, with one chunk of slack so the border does not flicker
+        for (int i = this->loadedCount - 1; i >= 0; i--) {
+            struct WorldChunk* node = this->loaded[i];
+            int dx = node->cx - centerX, dz = node->cz - centerZ;
+            if (dx * dx + dz * dz > (r + 1) * (r + 1))
+                World_unload(this, node);
+        }
+
+        // dirty chunks to the mesher. A chunk waits while a neighbor inside
+        // the radius is still missing, meshing it earlier would only redo it
+        // once that neighbor links. Deferred chunks and chunks owned by
+        // someone else go back on the queue.
+        struct Chunk* requeue = NULL;
+        struct Chunk* c;
+        while ((c = Chunk_popDirty())) {
+            struct WorldChunk* node = (struct WorldChunk*)c->owner;
+            int ours = node && node->state == s;
+            if (ours && c->dirty && node->generated && World_neighborsReady(this, node, centerX, centerZ)) {
+                World_submitMesh(this, node);
+            } else if (!ours || c->dirty) {
+                c->nextDirty = requeue;
+                requeue = c;
+            }
+        }
+        while (requeue) {
+            c = requeue;
+            requeue = c->nextDirty;
+            Chunk_markDirty(c);
+        }
+
+        // missing chunks, nearest first, those in front of the camera before
+        // those behind it
+        if (centerX != this->centerX || centerZ != this->centerZ)
+            this->complete = 0;
+        this->centerX = centerX;
+        this->centerZ = centerZ;
+        int budget = this->maxGenerating - s->generating;
+        if (this->complete || budget <= 0)
+            return;
+
+        struct WorldLoadCandidate* candidates = (struct WorldLoadCandidate*)malloc((2 * r + 1) * (2 * r + 1) * sizeof(struct WorldLoadCandidate));
+        int count = 0;
+        for (int dz = -r; dz <= r; dz++) {
+            for (int dx = -r; dx <= r; dx++) {
+                int d2 = dx * dx + dz * dz;
+                if (d2 > r * r || World_findNode(this, centerX + dx, centerZ + dz))
+                    continue;
+                float distance = sqrtf((float)d2);
+                float facing = (d2 > 0) ? (dx * forwardX + dz * forwardZ) / distance : 1.0f;
+                candidates[count++] = (struct WorldLoadCandidate) {
+                    .cx = centerX + dx,
+                    .cz = centerZ + dz,
+                    .score = distance * (1.25f - 0.75f * facing), // ahead 0.5x, behind 2x
+                };
+            }
+        }
+        if (count <= budget) {
+            this->complete = 1;
+        } else {
+            qsort(candidates, count, sizeof(struct WorldLoadCandidate), &World_compareCandidates);
+            count = budget;
+        }
+        for (int i = 0; i < count; i++)
+            World_load(this, candidates[i].cx, candidates[i].cz);
+        free(candidates);
+    }
+
+    // GL thread: upload meshed chunks, at least one, then until the budget
+    // runs out. Returns how many jobs were retired.
+    static int World_upload(struct World* this, double budgetSeconds) {
+        struct WorldState* s = this->state;
+        double start = glfwGetTime();
+        int count = 0;
+        for (;;) {
+            pthread_mutex_lock(&s->lock);
+            struct WorldMeshJob* job = s->meshedHead;
+            if (job) {
+                s->meshedHead = job->next;
+                if (!s->meshedHead) s->meshedTail = NULL;
+            }
+            pthread_mutex_unlock(&s->lock);
+            if (!job) break;
+
+            struct WorldChunk* node = job->node;
+            double jobStart = glfwGetTime();
+            // unloaded chunks and superseded meshes are thrown away
+            if (!node->unloading && job->request == node->chunk.meshRequest) {
+                if (s->batch)
+                    s->batch->store(s->batch, &node->chunk, &job->result);
+                else
+                    Chunk_uploadMesh(&node->chunk, &job->result);
+                double end = glfwGetTime();
+                pthread_mutex_lock(&s->lock);
+                World_recordStage(s, WORLD_STAGE_UPLOAD, jobStart, end);
+                pthread_mutex_unlock(&s->lock);
+            } else {
+                job->result.vertices.destroy(&job->result.vertices);
+            }
+            World_retire(s, node);
+            free(job);
+            count++;
+
+            if (glfwGetTime() - start >= budgetSeconds)
+                break;
+        }
+        return count;
+    }
+
+    // block until no job is running on the workers
+    static void World_wait(struct World* this) {
+        struct WorldState* s = this->state;
+        pthread_mutex_lock(&s->lock);
+        while (s->working)
+            pthread_cond_wait(&s->drained, &s->lock);
+        pthread_mutex_unlock(&s->lock);
+    }
+
+    // jobs submitted and not yet retired by update or upload
+    static int World_pending(struct World* this) {
+        struct WorldState* s = this->state;
+        pthread_mutex_lock(&s->lock);
+        int n = s->inFlight;
+        pthread_mutex_unlock(&s->lock);
+        return n;
+    }
+
+    static struct WorldStageStats World_stats(struct World* this, int stage) {
+        struct WorldState* s = this->state;
+        pthread_mutex_lock(&s->lock);
+        struct WorldStageStats st = s->stages[stage];
+        pthread_mutex_unlock(&s->lock);
+        return st;
+    }
+
+    // chunks stream in from the store and are saved to it on unload; call
+    // before the first update
+    static void World_setStore(struct World* this, struct RegionStore* store) {
+        this->state->store = store;
+    }
+
+    // attach before the first update: meshes already in per-chunk models are not moved over
+    static void World_setBatch(struct World* this, struct ChunkBatch* batch) {
+        this->state->batch = batch;
+    }
+
+    // write every loaded chunk with unsaved changes, returns how many
+    static int World_save(struct World* this) {
+        struct RegionStore* store = this->state->store;
+        int count = 0;
+        if (!store) return 0;
+        for (int i = 0; i < this->loadedCount; i++) {
+            struct WorldChunk* node = this->loaded[i];
+            if (node->generated)
+                count += store->save(store, &node->chunk, node->cx, node->cz);
+        }
+        return count;
+    }
+
+    // unloads (and so saves) every chunk; the store outlives the world
+    static void World_destroy(struct World* this) {
+        struct WorldState* s = this->state;
+        if (!s) return;
+        World_wait(this);
+        while (s->meshedHead) {
+            struct WorldMeshJob* job = s->meshedHead;
+            s->meshedHead = job->next;
+            job->result.vertices.destroy(&job->result.vertices);
+            World_retire(s, job->node);
+            free(job);
+        }
+        while (s->generatedHead) {
+            struct WorldChunk* node = s->generatedHead;
+            s->generatedHead = node->nextDone;
+            node->generated = 1; // so it is saved below
+            World_retire(s, node);
+        }
+        while (this->loadedCount)
+            World_unload(this, this->loaded[this->loadedCount - 1]);
+        if (s->ownsPool)
+            s->pool.destroy(&s->pool);
+        pthread_mutex_destroy(&s->lock);
+        pthread_cond_destroy(&s->drained);
+        free(s->visitQueue);
+        free(s);
+        free(this->loaded);
+        free(this->buckets);
+        this->loaded = NULL;
+        this->buckets = NULL;
+        this->state = NULL;
+    }
+
+    // generator and pool may be NULL for the default generator and a pool
+    // of the world's own
+    static struct World newWorld(int radius, struct WorldGenerator* generator, struct ThreadPool* pool) {
+        struct WorldState* s = (struct WorldState*)calloc(1, sizeof(struct WorldState));
+        s->ownsPool = pool == NULL;
+        s->pool = pool ? *pool : ThreadPool.new(0);
+        if (!generator) {
+            pthread_once(&ChunkDefaultGeneratorOnce, &Chunk_initDefaultGenerator);
+            generator = &ChunkDefaultGenerator;
+        }
+        s->generator = generator;
+        pthread_mutex_init(&s->lock, NULL);
+        pthread_cond_init(&s->drained, NULL);
+
+        return (struct World) {
+            .radius = radius,
+            .maxGenerating = s->pool.state->threadCount * 4,
+            .loaded = (struct WorldChunk**)malloc(64 * sizeof(struct WorldChunk*)),
+            .loadedCapacity = 64,
+            .buckets = (struct WorldChunk**)calloc(64, sizeof(struct WorldChunk*)),
+            .bucketCount = 64,
+            .centerX = INT32_MIN,
+            .state = s,
+            .update = &World_update,
+            .upload = &World_upload,
+            .wait = &World_wait,
+            .pending = &World_pending,
+            .stats = &World_stats,
+            .setStore = &World_setStore,
+            .setBatch = &World_setBatch,
+            .save = &World_save,
+            .destroy = &World_destroy,
+        };
+    }
+
+    static const struct {
+        struct World (*new)(int radius, struct WorldGenerator* generator, struct ThreadPool* pool);
+    } World = { .new = &newWorld };
+
+#endif
@@ -0,0 +1,23 @@
+#version 330 core
+in vec2 tileUV;
+flat in vec2 atlasCell;
+in vec3 normal;
+in vec3 worldPos;
+
+uniform sampler2D atlas;
+uniform vec3 lightPos;
+uniform vec3 lightColor;
+
+out vec4 fragColor;
+
+const float ATLAS_N = 2.0;
+
+void main() {
+    vec2 uv = (atlasCell + fract(tileUV)) / ATLAS_N;
+    vec4 albedo = texture(atlas, uv);
+
+    vec3 toLight = normalize(lightPos - worldPos);
+    float diffuse = max(dot(normal, toLight), 0.0);
+    vec3 lit = albedo.rgb * (0.3 + 0.7 * diffuse * lightColor);
+    fragColor = vec4(lit, albedo.a);
+}
@@ -0,0 +1,54 @@
+#version 330 core
+// Decodes the packed chunk vertex written by Chunk_packVertex (Chunk.h).
+layout(location = 0) in uint packedVertex;
+
+uniform mat4 proj;
+uniform mat4 view;
+uniform mat4 model;
+
+out vec2 tileUV;
+flat out vec2 atlasCell;
+out vec3 normal;
+out vec3 worldPos;
+
+const int ATLAS_N = 2; // 2x2 atlas, matches the chunk block ids
+
+const vec3 FACE_NORMALS[6] = vec3[6](
+    vec3( 0,  0,  1), // FRONT
+    vec3( 0,  0, -1), // BACK
+    vec3(-1,  0,  0), // LEFT
+    vec3( 1,  0,  0), // RIGHT
+    vec3( 0,  1,  0), // TOP
+    vec3( 0, -1,  0)  // BOTTOM
+);
+
+// per face: axis and sign the texture u runs along, then the same for v,
+// following CUBE_FACE_VERTS / CUBE_FACE_UVS
+const ivec4 FACE_UV_AXES[6] = ivec4[6](
+    ivec4(0,  1, 1,  1), // FRONT
+    ivec4(0, -1, 1,  1), // BACK
+    ivec4(2,  1, 1,  1), // LEFT
+    ivec4(2, -1, 1,  1), // RIGHT
+    ivec4(0,  1, 2, -1), // TOP
+    ivec4(0,  1, 2,  1)  // BOTTOM
+);
+
+void main() {
+    vec3 pos = vec3(
+        float(packedVertex         & 127u),
+        float((packedVertex >> 7)  & 127u),
+        float((packedVertex >> 14) & 127u));
+    int face  = int((packedVertex >> 21) & 7u);
+    int block = int(packedVertex >> 26);
+
+    // position based UVs repeat the block texture once per block, also
+    // across greedy-merged quads; the fragment shader wraps them with fract
+    ivec4 axes = FACE_UV_AXES[face];
+    tileUV = vec2(pos[axes.x] * float(axes.y), pos[axes.z] * float(axes.w));
+    atlasCell = vec2(block % ATLAS_N, block / ATLAS_N);
+
+    vec4 world = model * vec4(pos, 1.0);
+    worldPos = world.xyz;
+    normal = FACE_NORMALS[face];
+    gl_Position = proj * view * world;
+}